@@ -4,15 +4,32 @@
 
 const Camera::vec3 Camera::center_position() const
 {
-  return  vec3(position_[0] + front_dir_[0],
-               position_[1] + front_dir_[1],
-               position_[2] + front_dir_[2]);
+  return  position_ + front_direction();
+}
+
+void Camera::set_orientation(const quat& _orientation)
+{
+  orientation_ = kmuvcl::math::normalize(_orientation);
+}
+
+void Camera::set_orientation(const vec3& _front_dir, const vec3& _up_dir)
+{
+  // orthonormal camera basis; _up_dir need not be perpendicular to _front_dir
+  vec3  back = -1.0f * _front_dir;
+  back = (1.0f / std::sqrt(kmuvcl::math::dot(back, back))) * back;
+
+  vec3  right = kmuvcl::math::cross(_up_dir, back);
+  right = (1.0f / std::sqrt(kmuvcl::math::dot(right, right))) * right;
+
+  const vec3  up = kmuvcl::math::cross(back, right);
+
+  orientation_ = kmuvcl::math::normalize(kmuvcl::math::from_basis(right, up, back));
 }
 
 // TODO: fill up the following functions properly 
 void Camera::move_forward(float delta)
 {
-  position_ += delta * front_dir_;
+  position_ += delta * front_direction();
 }
 
 void Camera::move_backward(float delta)
@@ -22,7 +39,7 @@ void Camera::move_backward(float delta)
 
 void Camera::move_left(float delta)
 {
-  position_ -= delta * right_dir_;
+  position_ -= delta * right_direction();
 }
 
 void Camera::move_right(float delta)
@@ -32,7 +49,7 @@ void Camera::move_right(float delta)
 
 void Camera::move_up(float delta)
 {
-  position_ += delta * up_dir_;
+  position_ += delta * up_direction();
 }
 
 void Camera::move_down(float delta)
@@ -40,15 +57,13 @@ void Camera::move_down(float delta)
   move_up(-delta);
 }
 
+// yaw by delta degrees about the camera's own up axis; composing on the
+// right applies the rotation in the camera frame, and renormalizing keeps
+// the orientation a unit quaternion however many steps accumulate
 void Camera::rotate_left(float delta)
 {
-  mat4  Ry;
-  vec4  f(front_dir_[0], front_dir_[1], front_dir_[2], 0.0f);
-
-  f = Ry * f;
-
-  front_dir_ = vec3(f[0], f[1], f[2]);
-  right_dir_ = kmuvcl::math::cross(front_dir_, up_dir_);
+  orientation_ = kmuvcl::math::normalize(
+    orientation_ * kmuvcl::math::angle_axis(delta, 0.0f, 1.0f, 0.0f));
 }
 
 void Camera::rotate_right(float delta)
@@ -1,6 +1,7 @@
 #pragma once
 //#include <glm/glm.hpp>
 #include "vec.hpp"
+#include "quat.hpp"
 
 class Camera
 {
@@ -8,6 +9,7 @@ public:
   typedef typename  kmuvcl::math::vec3f     vec3;
   typedef typename  kmuvcl::math::vec4f     vec4;
   typedef typename  kmuvcl::math::mat4x4f   mat4;
+  typedef typename  kmuvcl::math::quatf     quat;
 
 public:
   enum Mode { kOrtho, kPerspective };
@@ -15,18 +17,16 @@ public:
 public:
   Camera()
     : position_(0,0,0), 
-      front_dir_(0,0,-1), 
-      up_dir_(0,1,0), 
-      right_dir_(1,0,0), 
+      orientation_(), 
       near_(-1),
       far_(1),
       fovy_(45),
       mode_(kOrtho)
   {}
   Camera(const vec3& _position, const vec3& _front_dir, const vec3& _up_dir, float _fovy)
-    : position_(_position), front_dir_(_front_dir), up_dir_(_up_dir), fovy_(_fovy)
+    : position_(_position), fovy_(_fovy)
   {
-    right_dir_ = kmuvcl::math::cross(front_dir_, up_dir_);
+    set_orientation(_front_dir, _up_dir);
   }
   
   void move_forward(float delta);
@@ -39,10 +39,14 @@ public:
   void rotate_right(float delta);
 	
   const vec3  position() const          { return  position_; }
-  const vec3  front_direction() const   { return  front_dir_; } 
-  const vec3  up_direction() const      { return  up_dir_; }
-  const vec3  right_direction() const   { return  right_dir_; }	
+  const vec3  front_direction() const   { return  orientation_ * vec3(0,0,-1); } 
+  const vec3  up_direction() const      { return  orientation_ * vec3(0,1,0); }
+  const vec3  right_direction() const   { return  orientation_ * vec3(1,0,0); }	
 	const vec3  center_position() const;
+
+  const quat& orientation() const       { return  orientation_; }
+  void        set_orientation(const quat& _orientation);
+  void        set_orientation(const vec3& _front_dir, const vec3& _up_dir);
   
 
   const float				near() const { return near_; }
@@ -58,9 +62,8 @@ public:
 
 private:
 	vec3  position_;    // position of the camera  
-  vec3  front_dir_;   // front direction of the camera    (it should be a unit vector whose length is 1)
-  vec3  up_dir_;      // up direction of the camera       (it should be a unit vector whose length is 1)
-  vec3  right_dir_;   // right direction of the camera    (it should be a unit vector whose length is 1)
+  quat  orientation_; // rotation from the camera frame to the world frame (a unit quaternion);
+                      // it maps (0,0,-1), (0,1,0) and (1,0,0) to the front, up and right directions
 
   float near_;        // near clipping plane 
   float far_;         // far clipping plane 
@@ -0,0 +1,326 @@
+#ifndef KMUVCL_GRAPHICS_BATCH_HPP
+#define KMUVCL_GRAPHICS_BATCH_HPP
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "vec.hpp"
+#include "mat.hpp"
+#include "operator.hpp"
+#include "simd.hpp"
+
+namespace kmuvcl {
+  namespace math {
+
+    // Batched transforms: one matrix applied to n points (w = 1), or to n
+    // matrices.
+    //
+    // SoA variants take separate x, y and z arrays; AoS variants take packed
+    // xyz triples. Outputs may alias the matching inputs (in-place transform).
+    // The 3-output variants drop w, i.e. they assume an affine matrix such as
+    // a model or view matrix.
+
+    /// (out_xs, out_ys, out_zs)_i = (A * (xs_i, ys_i, zs_i, 1)).xyz
+    template <typename T>
+    void transform_points(const mat<4, 4, T>& A,
+                          const T* xs, const T* ys, const T* zs,
+                          T* out_xs, T* out_ys, T* out_zs, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        const T x = xs[i], y = ys[i], z = zs[i];
+        out_xs[i] = A(0, 0)*x + A(0, 1)*y + A(0, 2)*z + A(0, 3);
+        out_ys[i] = A(1, 0)*x + A(1, 1)*y + A(1, 2)*z + A(1, 3);
+        out_zs[i] = A(2, 0)*x + A(2, 1)*y + A(2, 2)*z + A(2, 3);
+      }
+    }
+
+    /// (out_xs, out_ys, out_zs, out_ws)_i = A * (xs_i, ys_i, zs_i, 1)
+    template <typename T>
+    void transform_points(const mat<4, 4, T>& A,
+                          const T* xs, const T* ys, const T* zs,
+                          T* out_xs, T* out_ys, T* out_zs, T* out_ws, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        const T x = xs[i], y = ys[i], z = zs[i];
+        out_xs[i] = A(0, 0)*x + A(0, 1)*y + A(0, 2)*z + A(0, 3);
+        out_ys[i] = A(1, 0)*x + A(1, 1)*y + A(1, 2)*z + A(1, 3);
+        out_zs[i] = A(2, 0)*x + A(2, 1)*y + A(2, 2)*z + A(2, 3);
+        out_ws[i] = A(3, 0)*x + A(3, 1)*y + A(3, 2)*z + A(3, 3);
+      }
+    }
+
+    /// out_xyz_i = (A * (xyz_i, 1)).xyz for packed xyz triples
+    template <typename T>
+    void transform_points(const mat<4, 4, T>& A, const T* xyz, T* out_xyz, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i, xyz += 3, out_xyz += 3)
+      {
+        const T x = xyz[0], y = xyz[1], z = xyz[2];
+        out_xyz[0] = A(0, 0)*x + A(0, 1)*y + A(0, 2)*z + A(0, 3);
+        out_xyz[1] = A(1, 0)*x + A(1, 1)*y + A(1, 2)*z + A(1, 3);
+        out_xyz[2] = A(2, 0)*x + A(2, 1)*y + A(2, 2)*z + A(2, 3);
+      }
+    }
+
+    /// out_i = PV * models_i, e.g. the PVM matrices of n instances sharing one
+    /// proj * view matrix
+    template <typename T>
+    void multiply_matrices(const mat<4, 4, T>& PV, const mat<4, 4, T>* models,
+                           mat<4, 4, T>* out, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        out[i] = PV * models[i];
+    }
+
+#ifdef KMUVCL_USE_SSE
+    // float overloads: four points per SSE iteration (eight with AVX for the
+    // SoA layout), with the remainder handled by the scalar templates above.
+
+    namespace detail {
+
+      /// r = A(row, 0)*x + A(row, 1)*y + A(row, 2)*z + A(row, 3) for four points
+      inline __m128 transform_row(const float* A, unsigned int row,
+                                  __m128 x, __m128 y, __m128 z)
+      {
+        __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[row]), x),
+                              _mm_set1_ps(A[row + 12]));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(A[row + 4]), y));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(A[row + 8]), z));
+        return  r;
+      }
+
+#ifdef KMUVCL_USE_AVX
+      /// the same for eight points
+      inline __m256 transform_row(const float* A, unsigned int row,
+                                  __m256 x, __m256 y, __m256 z)
+      {
+        __m256 r = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(A[row]), x),
+                                 _mm256_set1_ps(A[row + 12]));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(A[row + 4]), y));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(A[row + 8]), z));
+        return  r;
+      }
+#endif
+
+      /// SoA kernel shared by the 3- and 4-output overloads (out_ws may be null);
+      /// returns the number of points processed
+      inline std::size_t transform_points_soa(const float* A,
+                                              const float* xs, const float* ys, const float* zs,
+                                              float* out_xs, float* out_ys, float* out_zs,
+                                              float* out_ws, std::size_t n)
+      {
+        std::size_t i = 0;
+
+#ifdef KMUVCL_USE_AVX
+        for (; i + 8 <= n; i += 8)
+        {
+          const __m256 x = _mm256_loadu_ps(xs + i);
+          const __m256 y = _mm256_loadu_ps(ys + i);
+          const __m256 z = _mm256_loadu_ps(zs + i);
+
+          _mm256_storeu_ps(out_xs + i, transform_row(A, 0, x, y, z));
+          _mm256_storeu_ps(out_ys + i, transform_row(A, 1, x, y, z));
+          _mm256_storeu_ps(out_zs + i, transform_row(A, 2, x, y, z));
+          if (out_ws)
+            _mm256_storeu_ps(out_ws + i, transform_row(A, 3, x, y, z));
+        }
+#endif
+        for (; i + 4 <= n; i += 4)
+        {
+          const __m128 x = _mm_loadu_ps(xs + i);
+          const __m128 y = _mm_loadu_ps(ys + i);
+          const __m128 z = _mm_loadu_ps(zs + i);
+
+          _mm_storeu_ps(out_xs + i, transform_row(A, 0, x, y, z));
+          _mm_storeu_ps(out_ys + i, transform_row(A, 1, x, y, z));
+          _mm_storeu_ps(out_zs + i, transform_row(A, 2, x, y, z));
+          if (out_ws)
+            _mm_storeu_ps(out_ws + i, transform_row(A, 3, x, y, z));
+        }
+
+        return  i;
+      }
+
+      /// C_i = A * B_i with the columns of A kept in registers across the batch
+      inline void mat4_mul_batch(const float* A, const mat<4, 4, float>* B,
+                                 mat<4, 4, float>* C, std::size_t n)
+      {
+#ifdef KMUVCL_USE_AVX
+        // as in simd::mat4_mul: two columns of C_i per 256-bit register
+        const __m256 a0 = _mm256_broadcast_ps((const __m128*)(A));
+        const __m256 a1 = _mm256_broadcast_ps((const __m128*)(A + 4));
+        const __m256 a2 = _mm256_broadcast_ps((const __m128*)(A + 8));
+        const __m256 a3 = _mm256_broadcast_ps((const __m128*)(A + 12));
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+          const float* b = B[i];
+          float* c = C[i];
+
+          const __m256 b01 = _mm256_loadu_ps(b);
+          const __m256 b23 = _mm256_loadu_ps(b + 8);
+
+          __m256 c01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+          c01 = _mm256_add_ps(c01, _mm256_mul_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55)));
+          c01 = _mm256_add_ps(c01, _mm256_mul_ps(a2, _mm256_shuffle_ps(b01, b01, 0xAA)));
+          c01 = _mm256_add_ps(c01, _mm256_mul_ps(a3, _mm256_shuffle_ps(b01, b01, 0xFF)));
+
+          __m256 c23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00));
+          c23 = _mm256_add_ps(c23, _mm256_mul_ps(a1, _mm256_shuffle_ps(b23, b23, 0x55)));
+          c23 = _mm256_add_ps(c23, _mm256_mul_ps(a2, _mm256_shuffle_ps(b23, b23, 0xAA)));
+          c23 = _mm256_add_ps(c23, _mm256_mul_ps(a3, _mm256_shuffle_ps(b23, b23, 0xFF)));
+
+          _mm256_storeu_ps(c,     c01);
+          _mm256_storeu_ps(c + 8, c23);
+        }
+#else
+        const __m128 a0 = _mm_loadu_ps(A);
+        const __m128 a1 = _mm_loadu_ps(A + 4);
+        const __m128 a2 = _mm_loadu_ps(A + 8);
+        const __m128 a3 = _mm_loadu_ps(A + 12);
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+          const float* b = B[i];
+          float* c = C[i];
+
+          // all four columns are computed before storing, so C_i may be B_i
+          __m128 r[4];
+          for (int j = 0; j < 4; ++j, b += 4)
+          {
+            r[j] = _mm_mul_ps(a0, _mm_set1_ps(b[0]));
+            r[j] = _mm_add_ps(r[j], _mm_mul_ps(a1, _mm_set1_ps(b[1])));
+            r[j] = _mm_add_ps(r[j], _mm_mul_ps(a2, _mm_set1_ps(b[2])));
+            r[j] = _mm_add_ps(r[j], _mm_mul_ps(a3, _mm_set1_ps(b[3])));
+          }
+
+          _mm_storeu_ps(c,      r[0]);
+          _mm_storeu_ps(c + 4,  r[1]);
+          _mm_storeu_ps(c + 8,  r[2]);
+          _mm_storeu_ps(c + 12, r[3]);
+        }
+#endif
+      }
+
+    } // detail
+
+    /// (out_xs, out_ys, out_zs)_i = (A * (xs_i, ys_i, zs_i, 1)).xyz
+    inline void transform_points(const mat<4, 4, float>& A,
+                                 const float* xs, const float* ys, const float* zs,
+                                 float* out_xs, float* out_ys, float* out_zs, std::size_t n)
+    {
+      std::size_t i = detail::transform_points_soa(A, xs, ys, zs,
+                                                   out_xs, out_ys, out_zs, 0, n);
+
+      transform_points<float>(A, xs + i, ys + i, zs + i,
+                              out_xs + i, out_ys + i, out_zs + i, n - i);
+    }
+
+    /// (out_xs, out_ys, out_zs, out_ws)_i = A * (xs_i, ys_i, zs_i, 1)
+    inline void transform_points(const mat<4, 4, float>& A,
+                                 const float* xs, const float* ys, const float* zs,
+                                 float* out_xs, float* out_ys, float* out_zs, float* out_ws,
+                                 std::size_t n)
+    {
+      std::size_t i = detail::transform_points_soa(A, xs, ys, zs,
+                                                   out_xs, out_ys, out_zs, out_ws, n);
+
+      transform_points<float>(A, xs + i, ys + i, zs + i,
+                              out_xs + i, out_ys + i, out_zs + i, out_ws + i, n - i);
+    }
+
+    /// out_xyz_i = (A * (xyz_i, 1)).xyz for packed xyz triples
+    inline void transform_points(const mat<4, 4, float>& A, const float* xyz, float* out_xyz,
+                                 std::size_t n)
+    {
+      const float* a = A;
+      std::size_t i = 0;
+
+      for (; i + 4 <= n; i += 4, xyz += 12, out_xyz += 12)
+      {
+        // x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3  ->  x0..x3, y0..y3, z0..z3
+        const __m128 p0 = _mm_loadu_ps(xyz);
+        const __m128 p1 = _mm_loadu_ps(xyz + 4);
+        const __m128 p2 = _mm_loadu_ps(xyz + 8);
+
+        const __m128 xy23 = _mm_shuffle_ps(p1, p2, _MM_SHUFFLE(2, 1, 3, 2));
+        const __m128 yz01 = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(1, 0, 2, 1));
+        const __m128 x = _mm_shuffle_ps(p0, xy23, _MM_SHUFFLE(2, 0, 3, 0));
+        const __m128 y = _mm_shuffle_ps(yz01, xy23, _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128 z = _mm_shuffle_ps(yz01, p2, _MM_SHUFFLE(3, 0, 3, 1));
+
+        const __m128 tx = detail::transform_row(a, 0, x, y, z);
+        const __m128 ty = detail::transform_row(a, 1, x, y, z);
+        const __m128 tz = detail::transform_row(a, 2, x, y, z);
+
+        // and back to packed triples
+        const __m128 txy01 = _mm_unpacklo_ps(tx, ty);    // x0 y0 x1 y1
+        const __m128 txy23 = _mm_unpackhi_ps(tx, ty);    // x2 y2 x3 y3
+        const __m128 zx01  = _mm_shuffle_ps(tz, txy01, _MM_SHUFFLE(2, 2, 0, 0));
+        const __m128 yz11  = _mm_shuffle_ps(txy01, tz, _MM_SHUFFLE(1, 1, 3, 3));
+        const __m128 zx23  = _mm_shuffle_ps(tz, txy23, _MM_SHUFFLE(2, 2, 2, 2));
+        const __m128 yz33  = _mm_shuffle_ps(txy23, tz, _MM_SHUFFLE(3, 3, 3, 3));
+
+        _mm_storeu_ps(out_xyz,     _mm_shuffle_ps(txy01, zx01, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(out_xyz + 4, _mm_shuffle_ps(yz11, txy23, _MM_SHUFFLE(1, 0, 2, 0)));
+        _mm_storeu_ps(out_xyz + 8, _mm_shuffle_ps(zx23, yz33, _MM_SHUFFLE(2, 0, 2, 0)));
+      }
+
+      transform_points<float>(A, xyz, out_xyz, n - i);
+    }
+
+    /// out_i = PV * models_i
+    inline void multiply_matrices(const mat<4, 4, float>& PV, const mat<4, 4, float>* models,
+                                  mat<4, 4, float>* out, std::size_t n)
+    {
+      detail::mat4_mul_batch(PV, models, out, n);
+    }
+#endif // KMUVCL_USE_SSE
+
+    /// out_i = PV * models_i, split into contiguous chunks over num_threads
+    /// threads (0: std::thread::hardware_concurrency()). Chunks are at least
+    /// min_chunk matrices long so that small batches stay on the calling
+    /// thread, which also processes the first chunk itself.
+    template <typename T>
+    void multiply_matrices(const mat<4, 4, T>& PV, const mat<4, 4, T>* models,
+                           mat<4, 4, T>* out, std::size_t n,
+                           unsigned int num_threads, std::size_t min_chunk = 4096)
+    {
+      if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+      if (min_chunk == 0)
+        min_chunk = 1;
+
+      std::size_t num_chunks = (n + min_chunk - 1) / min_chunk;
+      if (num_chunks > num_threads)
+        num_chunks = num_threads;
+      if (num_chunks <= 1)
+      {
+        multiply_matrices(PV, models, out, n);
+        return;
+      }
+
+      const std::size_t chunk = (n + num_chunks - 1) / num_chunks;
+
+      std::vector<std::thread> workers;
+      workers.reserve(num_chunks - 1);
+      for (std::size_t begin = chunk; begin < n; begin += chunk)
+      {
+        const std::size_t count = (n - begin < chunk) ? n - begin : chunk;
+        workers.emplace_back([&PV, models, out, begin, count]() {
+          multiply_matrices(PV, models + begin, out + begin, count);
+        });
+      }
+
+      multiply_matrices(PV, models, out, chunk);
+
+      for (std::size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    }
+
+  } // math
+} // kmuvcl
+
+#endif // KMUVCL_GRAPHICS_BATCH_HPP
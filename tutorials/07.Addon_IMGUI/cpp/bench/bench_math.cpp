@@ -0,0 +1,228 @@
+// Micro-benchmarks for vec.hpp, mat.hpp, operator.hpp and transform.hpp.
+//
+// Runs headless (no GL) and reports ns/op per operation, element type and
+// dimension. JSON output is meant to be kept and diffed across changes:
+//
+//   make && ./bench_math --benchmark_format=json > baseline.json
+//   ./bench_math --benchmark_filter='mat_mul' --benchmark_out=mat_mul.json
+//
+// Built on Google Benchmark (libbenchmark), so its flags, output formats and
+// tools/compare.py all apply. Every benchmark cycles through kInputs
+// precomputed operands so that the results cannot be constant-folded, and
+// hands each result to benchmark::DoNotOptimize.
+//
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "vec.hpp"
+#include "mat.hpp"
+#include "operator.hpp"
+#include "transform.hpp"
+
+using namespace kmuvcl::math;
+
+static const unsigned int kInputs = 64;    // power of two
+
+template <typename T>
+T random_value()
+{
+  return  static_cast<T>(std::rand() % 2000 - 1000) / static_cast<T>(1000);
+}
+
+template <unsigned int N, typename T>
+std::vector< vec<N, T> > random_vecs()
+{
+  std::vector< vec<N, T> > vs(kInputs);
+  for (unsigned int i = 0; i < kInputs; ++i)
+    for (unsigned int k = 0; k < N; ++k)
+      vs[i](k) = random_value<T>();
+
+  return  vs;
+}
+
+template <unsigned int N, typename T>
+std::vector< mat<N, N, T> > random_mats()
+{
+  std::vector< mat<N, N, T> > ms(kInputs);
+  for (unsigned int i = 0; i < kInputs; ++i)
+    for (unsigned int r = 0; r < N; ++r)
+      for (unsigned int c = 0; c < N; ++c)
+        ms[i](r, c) = random_value<T>();
+
+  return  ms;
+}
+
+template <unsigned int N, typename T>
+void bm_vec_add(benchmark::State& state)
+{
+  const std::vector< vec<N, T> > u = random_vecs<N, T>(), v = random_vecs<N, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    vec<N, T> w = u[i] + v[i];
+    benchmark::DoNotOptimize(w);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <unsigned int N, typename T>
+void bm_vec_dot(benchmark::State& state)
+{
+  const std::vector< vec<N, T> > u = random_vecs<N, T>(), v = random_vecs<N, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    T s = dot(u[i], v[i]);
+    benchmark::DoNotOptimize(s);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <typename T>
+void bm_vec_cross(benchmark::State& state)
+{
+  const std::vector< vec<3, T> > u = random_vecs<3, T>(), v = random_vecs<3, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    vec<3, T> w = cross(u[i], v[i]);
+    benchmark::DoNotOptimize(w);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <unsigned int N, typename T>
+void bm_mat_vec(benchmark::State& state)
+{
+  const std::vector< mat<N, N, T> > A = random_mats<N, T>();
+  const std::vector< vec<N, T> > x = random_vecs<N, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    vec<N, T> y = A[i] * x[i];
+    benchmark::DoNotOptimize(y);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <unsigned int N, typename T>
+void bm_mat_mul(benchmark::State& state)
+{
+  const std::vector< mat<N, N, T> > A = random_mats<N, T>(), B = random_mats<N, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    mat<N, N, T> C = A[i] * B[i];
+    benchmark::DoNotOptimize(C);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <unsigned int N, typename T>
+void bm_transpose(benchmark::State& state)
+{
+  const std::vector< mat<N, N, T> > A = random_mats<N, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    mat<N, N, T> B = A[i].transpose();
+    benchmark::DoNotOptimize(B);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <typename T>
+void bm_lookAt(benchmark::State& state)
+{
+  const std::vector< vec<3, T> > eye = random_vecs<3, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    const vec<3, T>& e = eye[i];
+    mat<4, 4, T> V = lookAt(e(0), e(1), e(2) + static_cast<T>(3),
+                            static_cast<T>(0), static_cast<T>(0), static_cast<T>(0),
+                            static_cast<T>(0), static_cast<T>(1), static_cast<T>(0));
+    benchmark::DoNotOptimize(V);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <typename T>
+void bm_perspective(benchmark::State& state)
+{
+  const std::vector< vec<3, T> > p = random_vecs<3, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    const vec<3, T>& q = p[i];
+    mat<4, 4, T> P = perspective(static_cast<T>(45) + q(0), static_cast<T>(1.5) + q(1),
+                                 static_cast<T>(0.1), static_cast<T>(100));
+    benchmark::DoNotOptimize(P);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <typename T>
+void bm_rotate(benchmark::State& state)
+{
+  const std::vector< vec<4, T> > p = random_vecs<4, T>();
+  unsigned int i = 0;
+  for (auto _ : state)
+  {
+    const vec<4, T>& q = p[i];
+    mat<4, 4, T> R = rotate(static_cast<T>(180) * q(0), q(1), q(2), q(3) + static_cast<T>(2));
+    benchmark::DoNotOptimize(R);
+    i = (i + 1) & (kInputs - 1);
+  }
+}
+
+template <unsigned int N, typename T>
+void add_vec_mat(const std::string& type)
+{
+  const std::string suffix = "<" + type + ", " + std::to_string(N) + ">";
+
+  benchmark::RegisterBenchmark(("vec_add" + suffix).c_str(), bm_vec_add<N, T>);
+  benchmark::RegisterBenchmark(("vec_dot" + suffix).c_str(), bm_vec_dot<N, T>);
+  benchmark::RegisterBenchmark(("mat_vec" + suffix).c_str(), bm_mat_vec<N, T>);
+  benchmark::RegisterBenchmark(("mat_mul" + suffix).c_str(), bm_mat_mul<N, T>);
+  benchmark::RegisterBenchmark(("transpose" + suffix).c_str(), bm_transpose<N, T>);
+}
+
+template <typename T>
+void add_all(const std::string& type)
+{
+  add_vec_mat<2, T>(type);
+  add_vec_mat<3, T>(type);
+  add_vec_mat<4, T>(type);
+
+  benchmark::RegisterBenchmark(("vec_cross<" + type + ">").c_str(), bm_vec_cross<T>);
+  benchmark::RegisterBenchmark(("lookAt<" + type + ">").c_str(), bm_lookAt<T>);
+  benchmark::RegisterBenchmark(("perspective<" + type + ">").c_str(), bm_perspective<T>);
+  benchmark::RegisterBenchmark(("rotate<" + type + ">").c_str(), bm_rotate<T>);
+}
+
+int main(int argc, char** argv)
+{
+  std::srand(1);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return  1;
+
+#if defined(KMUVCL_USE_AVX)
+  benchmark::AddCustomContext("simd", "avx");
+#elif defined(KMUVCL_USE_SSE)
+  benchmark::AddCustomContext("simd", "sse2");
+#else
+  benchmark::AddCustomContext("simd", "scalar");
+#endif
+  add_all<float>("float");
+  add_all<double>("double");
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return  0;
+}
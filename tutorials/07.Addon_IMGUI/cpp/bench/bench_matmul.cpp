@@ -0,0 +1,110 @@
+// Micro-benchmark for the matrix product kernels in operator.hpp.
+//
+// Compares operator* against the previous implementation, which copied a row
+// of A and a column of B into zero-filled vec temporaries for every element
+// of the result.
+//
+//   make && ./bench_matmul
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "vec.hpp"
+#include "mat.hpp"
+#include "operator.hpp"
+
+using namespace kmuvcl::math;
+
+// C_{mxl} = A_{mxn} * B_{nxl} as operator.hpp used to compute it
+template <unsigned int M, unsigned int N, unsigned int L, typename T>
+mat<M, L, T> legacy_mul(const mat<M, N, T>& A, const mat<N, L, T>& B)
+{
+  mat<M, L, T>   C;
+  vec<N, T>   row;
+  vec<N, T>   col;
+
+  for (unsigned int i = 0; i < M; ++i)
+  {
+    A.get_ith_row(i, row);
+
+    for (unsigned int j = 0; j < L; ++j)
+    {
+      B.get_ith_column(j, col);
+
+      T s = 0;
+      for (unsigned int k = 0; k < N; ++k)
+        s += row(k) * col(k);
+      C(i, j) = s;
+    }
+  }
+
+  return  C;
+}
+
+static const unsigned int kBatch   = 256;     // matrices per pass (fits in L1/L2)
+static const unsigned int kPasses  = 20000;
+
+template <unsigned int N, typename T>
+void fill_random(std::vector< mat<N, N, T> >& ms)
+{
+  for (size_t m = 0; m < ms.size(); ++m)
+    for (unsigned int r = 0; r < N; ++r)
+      for (unsigned int c = 0; c < N; ++c)
+        ms[m](r, c) = static_cast<T>(std::rand() % 200 - 100) / static_cast<T>(100);
+}
+
+// returns nanoseconds per product
+template <unsigned int N, typename T, typename Mul>
+double run(const std::vector< mat<N, N, T> >& a, const std::vector< mat<N, N, T> >& b,
+           std::vector< mat<N, N, T> >& c, Mul mul, T& checksum)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  for (unsigned int p = 0; p < kPasses; ++p)
+    for (unsigned int i = 0; i < kBatch; ++i)
+      c[i] = mul(a[i], b[(i + p) % kBatch]);
+
+  auto stop = std::chrono::steady_clock::now();
+
+  // consume the results so that the products cannot be optimized away
+  for (unsigned int i = 0; i < kBatch; ++i)
+    checksum += c[i](0, 0) + c[i](N - 1, N - 1);
+
+  double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+  return  ns / (double(kPasses) * kBatch);
+}
+
+template <unsigned int N, typename T>
+void compare(const char* name)
+{
+  typedef mat<N, N, T>  matrix;
+
+  std::vector<matrix> a(kBatch), b(kBatch), c(kBatch);
+  fill_random(a);
+  fill_random(b);
+
+  T checksum_legacy = 0, checksum_new = 0;
+
+  double t_legacy = run(a, b, c,
+    [](const matrix& x, const matrix& y) { return legacy_mul(x, y); }, checksum_legacy);
+  double t_new    = run(a, b, c,
+    [](const matrix& x, const matrix& y) { return x * y; }, checksum_new);
+
+  std::printf("%-8s legacy %7.2f ns   operator* %7.2f ns   speedup %5.2fx   (checksum %g / %g)\n",
+              name, t_legacy, t_new, t_legacy / t_new,
+              double(checksum_legacy), double(checksum_new));
+}
+
+int main()
+{
+  std::srand(1);
+
+  compare<3, float>("mat3f");
+  compare<3, double>("mat3d");
+  compare<4, float>("mat4f");
+  compare<4, double>("mat4d");
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Checks the SSE inverse, affine_inverse and inverse_transpose3x3 of
+// mat4f (simd.hpp) against the scalar detail:: templates in double.
+//
+// Random affine matrices (rotation, scale with random signs, translation),
+// mirrors such as scale(-1, 1, 1) and perspective matrices are inverted both
+// ways; an element counts as wrong when it differs by more than
+// kTolerance * (1 + |reference|). Exits with 1 on any mismatch.
+//
+//   make && ./check_inverse [matrices (default 20000)]
+//
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "vec.hpp"
+#include "mat.hpp"
+#include "operator.hpp"
+#include "transform.hpp"
+#include "inverse.hpp"
+
+using namespace kmuvcl::math;
+
+static const double kTolerance = 1e-4;
+
+float random_value(float lo, float hi)
+{
+  return  lo + (hi - lo) * static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
+}
+
+template <unsigned int M, unsigned int N>
+mat<M, N, double> to_double(const mat<M, N, float>& A)
+{
+  mat<M, N, double> B;
+  for (unsigned int i = 0; i < M; ++i)
+    for (unsigned int j = 0; j < N; ++j)
+      B(i, j) = A(i, j);
+  return  B;
+}
+
+// number of elements of A that differ from the reference R
+template <unsigned int M, unsigned int N>
+unsigned int mismatches(const mat<M, N, float>& A, const mat<M, N, double>& R)
+{
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < M; ++i)
+    for (unsigned int j = 0; j < N; ++j)
+      if (!(std::abs(A(i, j) - R(i, j)) <= kTolerance * (1.0 + std::abs(R(i, j)))))
+        ++count;
+  return  count;
+}
+
+mat4x4f random_affine()
+{
+  const float s[3] = {
+    random_value(0.5f, 2.0f) * (std::rand() % 2 ? -1.0f : 1.0f),
+    random_value(0.5f, 2.0f) * (std::rand() % 2 ? -1.0f : 1.0f),
+    random_value(0.5f, 2.0f) * (std::rand() % 2 ? -1.0f : 1.0f)
+  };
+
+  return  translate(random_value(-10.0f, 10.0f), random_value(-10.0f, 10.0f), random_value(-10.0f, 10.0f))
+        * rotate(random_value(-180.0f, 180.0f), random_value(-1.0f, 1.0f), random_value(-1.0f, 1.0f), 1.0f)
+        * scale(s[0], s[1], s[2]);
+}
+
+int main(int argc, char** argv)
+{
+  const int n = (argc > 1) ? std::atoi(argv[1]) : 20000;
+  std::srand(1);
+
+  std::vector<mat4x4f> affine;
+  affine.push_back(scale(-1.0f, 1.0f, 1.0f));
+  affine.push_back(translate(1.0f, 2.0f, 3.0f) * scale(-1.0f, 1.0f, 1.0f));
+  affine.push_back(translate(-4.0f, 0.5f, 2.0f) * scale(1.0f, -2.0f, -3.0f));
+  for (int i = 0; i < n; ++i)
+    affine.push_back(random_affine());
+
+  std::vector<mat4x4f> general(affine);
+  for (int i = 0; i < n / 10; ++i)
+    general.push_back(perspective(random_value(30.0f, 90.0f), random_value(0.5f, 2.0f), 0.1f, 100.0f) * random_affine());
+
+  unsigned int bad_inverse = 0, bad_affine = 0, bad_normal = 0;
+  for (size_t i = 0; i < general.size(); ++i)
+    bad_inverse += mismatches(detail::inverse(general[i]), detail::inverse(to_double(general[i]))) != 0;
+
+  for (size_t i = 0; i < affine.size(); ++i)
+  {
+    const mat<4, 4, double> A = to_double(affine[i]);
+    bad_affine += mismatches(detail::affine_inverse(affine[i]), detail::affine_inverse(A)) != 0;
+    bad_normal += mismatches(detail::inverse_transpose3x3(affine[i]), detail::inverse_transpose3x3(A)) != 0;
+  }
+
+#ifdef KMUVCL_USE_SSE
+  const char* path = "sse";
+#else
+  const char* path = "scalar";
+#endif
+  std::printf("%s path, %zu matrices (%zu affine)\n", path, general.size(), affine.size());
+  std::printf("inverse               %u wrong\n", bad_inverse);
+  std::printf("affine_inverse        %u wrong\n", bad_affine);
+  std::printf("inverse_transpose3x3  %u wrong\n", bad_normal);
+
+  return  (bad_inverse + bad_affine + bad_normal == 0) ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <chrono>
+
+AssetLoader::AssetLoader(unsigned int num_threads)
+	: pending_(0), stopping_(false)
+{
+	if (num_threads == 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < num_threads; ++i)
+		threads_.push_back(std::thread(&AssetLoader::work, this));
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+		queued_.clear();
+	}
+	wake_.notify_all();
+
+	for (size_t i = 0; i < threads_.size(); ++i)
+		threads_[i].join();
+}
+
+std::shared_future<bool> AssetLoader::load(Object& object, const std::string& filename,
+	const VertexFormat& format, bool optimize)
+{
+	if (object.mesh().ib.empty())
+		object.set_placeholder();
+
+	std::unique_ptr<Job> job(new Job);
+	job->object = &object;
+	job->filename = filename;
+	job->format = format;
+	job->optimize = optimize;
+	job->loaded = false;
+	std::shared_future<bool> done = job->done.get_future().share();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queued_.push_back(std::move(job));
+		++pending_;
+	}
+	wake_.notify_one();
+
+	return done;
+}
+
+size_t AssetLoader::finish_uploads(double budget_ms)
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point start = Clock::now();
+
+	for (;;)
+	{
+		std::unique_ptr<Job> job;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (loaded_.empty())
+				return pending_;
+
+			job = std::move(loaded_.front());
+			loaded_.pop_front();
+		}
+
+		if (job->loaded)
+			job->object->set_mesh(job->mesh);
+		job->done.set_value(job->loaded);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		--pending_;
+		if (std::chrono::duration<double, std::milli>(Clock::now() - start).count() >= budget_ms)
+			return pending_;
+	}
+}
+
+size_t AssetLoader::pending() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return pending_;
+}
+
+void AssetLoader::work()
+{
+	for (;;)
+	{
+		std::unique_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this]() { return stopping_ || !queued_.empty(); });
+			if (stopping_)
+				return;
+
+			job = std::move(queued_.front());
+			queued_.pop_front();
+		}
+
+		job->loaded = Object::load_mesh(job->filename, job->format, 1, job->optimize, job->mesh);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		loaded_.push_back(std::move(job));
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mesh.h"
+#include "Object.h"
+
+// Loads Object meshes on a pool of worker threads. Parsing, building and the
+// mesh cache run on the workers (Object::load_mesh); the GL thread hands the
+// finished meshes to their objects in finish_uploads, a few per frame, so a
+// large scene never holds up a frame. Until then an object draws a
+// placeholder box.
+class AssetLoader
+{
+public:
+	// num_threads workers, 0 for one per core
+	explicit AssetLoader(unsigned int num_threads = 0);
+
+	// drops the loads not started yet and waits for the others
+	~AssetLoader();
+
+	// queues filename for object, which must outlive the load; the future
+	// turns true (or false on failure) once finish_uploads has handed the
+	// mesh over. On the GL thread.
+	std::shared_future<bool> load(Object& object, const std::string& filename,
+		const VertexFormat& format = VertexFormat(), bool optimize = false);
+
+	// on the GL thread, once per frame: hands loaded meshes to their objects
+	// (and so uploads them) until budget_ms have passed, at least one per call;
+	// returns the number of loads still pending
+	size_t finish_uploads(double budget_ms);
+
+	size_t pending() const;
+
+private:
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	struct Job
+	{
+		Object*							object;
+		std::string					filename;
+		VertexFormat				format;
+		bool								optimize;
+
+		Mesh								mesh;
+		bool								loaded;
+		std::promise<bool>	done;
+	};
+
+	void work();
+
+	std::vector<std::thread>						threads_;
+
+	mutable std::mutex									mutex_;
+	std::condition_variable							wake_;
+	std::deque<std::unique_ptr<Job> >		queued_;			// waiting for a worker
+	std::deque<std::unique_ptr<Job> >		loaded_;			// waiting for the GL thread
+	size_t															pending_;			// loads not handed over yet
+	bool																stopping_;
+};
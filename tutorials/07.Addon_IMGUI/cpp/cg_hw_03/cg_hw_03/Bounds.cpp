@@ -0,0 +1,233 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BOUNDS_SSE2 1
+#endif
+
+#include "Mesh.h"
+#include "MeshBuilder.h"
+
+namespace {
+
+	inline glm::vec3 load(const float* positions, size_t stride, size_t i)
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + i * stride);
+		return glm::vec3(p[0], p[1], p[2]);
+	}
+
+	// box of the quantized positions of mesh, which are 4 unsigned shorts
+	// (xyz and padding) each: the smallest and largest values decode to the
+	// box, as the decoding is increasing
+	Aabb quantized_aabb(const Mesh& mesh)
+	{
+		const VertexFormat& format = mesh.format;
+		const unsigned char* p = mesh.vb.data() + format.offset(VertexFormat::POSITION, mesh.vertex_count);
+		const size_t step = format.step(VertexFormat::POSITION);
+
+		unsigned short lo[4] = { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF };
+		unsigned short hi[4] = { 0, 0, 0, 0 };
+		size_t i = 0;
+
+#ifdef BOUNDS_SSE2
+		// SSE2 only compares signed shorts: flipping the sign bit maps the
+		// unsigned order onto the signed one
+		const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+		__m128i vlo = _mm_set1_epi16(0x7FFF);
+		__m128i vhi = _mm_set1_epi16(static_cast<short>(0x8000));
+		for (; i < mesh.vertex_count; ++i)
+		{
+			const __m128i v = _mm_xor_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + i * step)), flip);
+			vlo = _mm_min_epi16(vlo, v);
+			vhi = _mm_max_epi16(vhi, v);
+		}
+
+		unsigned short out[8];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_xor_si128(vlo, flip));
+		std::memcpy(lo, out, sizeof(lo));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_xor_si128(vhi, flip));
+		std::memcpy(hi, out, sizeof(hi));
+#endif
+
+		for (; i < mesh.vertex_count; ++i)
+		{
+			unsigned short q[4];
+			std::memcpy(q, p + i * step, sizeof(q));
+			for (int c = 0; c < 3; ++c)
+			{
+				lo[c] = std::min(lo[c], q[c]);
+				hi[c] = std::max(hi[c], q[c]);
+			}
+		}
+
+		const float kScale = 1.0f / 65535.0f;
+		return Aabb(glm::vec3(lo[0], lo[1], lo[2]) * kScale * mesh.position_scale + mesh.position_offset,
+			glm::vec3(hi[0], hi[1], hi[2]) * kScale * mesh.position_scale + mesh.position_offset);
+	}
+
+}
+
+Aabb Bounds::aabb(const float* positions, size_t count, size_t stride)
+{
+	if (count == 0)
+		return Aabb();
+
+	glm::vec3 lo = load(positions, stride, count - 1), hi = lo;
+	size_t i = 0;
+
+#ifdef BOUNDS_SSE2
+	// four floats are read per vertex; the fourth belongs to this vertex or to
+	// the next one, so the last vertex is left to the scalar loop
+	__m128 vlo = _mm_set_ps(0.0f, lo.z, lo.y, lo.x);
+	__m128 vhi = vlo;
+	const char* p = reinterpret_cast<const char*>(positions);
+	for (; i + 1 < count; ++i)
+	{
+		const __m128 v = _mm_loadu_ps(reinterpret_cast<const float*>(p + i * stride));
+		vlo = _mm_min_ps(vlo, v);
+		vhi = _mm_max_ps(vhi, v);
+	}
+
+	float out[4];
+	_mm_storeu_ps(out, vlo);
+	lo = glm::vec3(out[0], out[1], out[2]);
+	_mm_storeu_ps(out, vhi);
+	hi = glm::vec3(out[0], out[1], out[2]);
+#endif
+
+	for (; i + 1 < count; ++i)
+	{
+		const glm::vec3 v = load(positions, stride, i);
+		lo = glm::min(lo, v);
+		hi = glm::max(hi, v);
+	}
+
+	return Aabb(lo, hi);
+}
+
+BoundingSphere Bounds::sphere(const float* positions, size_t count, size_t stride)
+{
+	if (count == 0)
+		return BoundingSphere();
+
+	// the points of smallest and largest x, y and z
+	size_t extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for (size_t i = 1; i < count; ++i)
+	{
+		const glm::vec3 v = load(positions, stride, i);
+		for (int c = 0; c < 3; ++c)
+		{
+			if (v[c] < load(positions, stride, extremes[2 * c])[c])
+				extremes[2 * c] = i;
+			if (v[c] > load(positions, stride, extremes[2 * c + 1])[c])
+				extremes[2 * c + 1] = i;
+		}
+	}
+
+	// the pair farthest apart is the first diameter
+	int axis = 0;
+	float longest = -1.0f;
+	for (int c = 0; c < 3; ++c)
+	{
+		const glm::vec3 d = load(positions, stride, extremes[2 * c + 1]) - load(positions, stride, extremes[2 * c]);
+		if (glm::dot(d, d) > longest)
+		{
+			axis = c;
+			longest = glm::dot(d, d);
+		}
+	}
+
+	const glm::vec3 a = load(positions, stride, extremes[2 * axis]);
+	const glm::vec3 b = load(positions, stride, extremes[2 * axis + 1]);
+	glm::vec3 center = (a + b) * 0.5f;
+	float radius = std::sqrt(longest) * 0.5f;
+
+	// every point outside moves the sphere towards it just enough
+	for (size_t i = 0; i < count; ++i)
+	{
+		const glm::vec3 v = load(positions, stride, i);
+		const float d = glm::length(v - center);
+		if (d > radius)
+		{
+			const float grown = (radius + d) * 0.5f;
+			center = v + (center - v) * (grown / d);
+			radius = grown;
+		}
+	}
+
+	const glm::vec3 box_center = aabb(positions, count, stride).center();
+	float box_radius = 0.0f;
+	for (size_t i = 0; i < count; ++i)
+		box_radius = std::max(box_radius, glm::length(load(positions, stride, i) - box_center));
+
+	return (box_radius < radius) ? BoundingSphere(box_center, box_radius) : BoundingSphere(center, radius);
+}
+
+void Bounds::compute(Mesh& mesh)
+{
+	const VertexFormat& format = mesh.format;
+	if (mesh.vertex_count == 0)
+	{
+		mesh.aabb = Aabb();
+		mesh.sphere = BoundingSphere();
+		return;
+	}
+
+	if (format.encoding == VertexFormat::FLOAT)
+	{
+		const float* positions = reinterpret_cast<const float*>(mesh.vb.data() +
+			format.offset(VertexFormat::POSITION, mesh.vertex_count));
+		const size_t step = format.step(VertexFormat::POSITION);
+
+		mesh.aabb = aabb(positions, mesh.vertex_count, step);
+		mesh.sphere = sphere(positions, mesh.vertex_count, step);
+		return;
+	}
+
+	mesh.aabb = quantized_aabb(mesh);
+
+	std::vector<glm::vec3> positions(mesh.vertex_count);
+	for (size_t i = 0; i < mesh.vertex_count; ++i)
+		positions[i] = MeshBuilder::position(mesh, i);
+	mesh.sphere = sphere(&positions[0].x, positions.size(), sizeof(glm::vec3));
+}
+
+Aabb Bounds::transform(const Aabb& aabb, const glm::mat4& model)
+{
+	if (aabb.empty())
+		return aabb;
+
+	// the half size along each axis gathers the absolute matrix entries
+	const glm::vec3 c = aabb.center();
+	const glm::vec3 e = aabb.extent();
+	const glm::vec4 center = model * glm::vec4(c, 1.0f);
+
+	glm::vec3 extent(0.0f);
+	for (int row = 0; row < 3; ++row)
+	{
+		extent[row] = std::fabs(model[0][row]) * e.x + std::fabs(model[1][row]) * e.y +
+			std::fabs(model[2][row]) * e.z;
+	}
+
+	const glm::vec3 mid(center.x, center.y, center.z);
+	return Aabb(mid - extent, mid + extent);
+}
+
+BoundingSphere Bounds::transform(const BoundingSphere& sphere, const glm::mat4& model)
+{
+	if (sphere.radius < 0.0f)
+		return sphere;
+
+	// the radius grows by the largest scale of the matrix
+	float scale = 0.0f;
+	for (int column = 0; column < 3; ++column)
+		scale = std::max(scale, glm::length(glm::vec3(model[column][0], model[column][1], model[column][2])));
+
+	const glm::vec4 center = model * glm::vec4(sphere.center, 1.0f);
+	return BoundingSphere(glm::vec3(center.x, center.y, center.z), sphere.radius * scale);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+struct Mesh;
+
+// axis-aligned box; empty (lo > hi) when it holds no point
+struct Aabb
+{
+	glm::vec3	lo, hi;
+
+	Aabb() : lo(1.0f), hi(-1.0f) {}
+	Aabb(const glm::vec3& lo, const glm::vec3& hi) : lo(lo), hi(hi) {}
+
+	bool				empty() const		{ return lo.x > hi.x || lo.y > hi.y || lo.z > hi.z; }
+	glm::vec3		center() const	{ return (lo + hi) * 0.5f; }
+	glm::vec3		extent() const	{ return (hi - lo) * 0.5f; }		// half size
+};
+
+struct BoundingSphere
+{
+	glm::vec3	center;
+	float			radius;				// negative when it holds no point
+
+	BoundingSphere() : center(0.0f), radius(-1.0f) {}
+	BoundingSphere(const glm::vec3& center, float radius) : center(center), radius(radius) {}
+};
+
+// Bounding volumes of vertex positions, and their transformation.
+class Bounds
+{
+public:
+	// box of count xyz float triples stride bytes apart, with SSE2 min/max
+	// where available
+	static Aabb aabb(const float* positions, size_t count, size_t stride);
+
+	// Ritter's sphere, grown from the farthest pair of the axis extremes to
+	// take in every point, or the sphere around the center of the box when
+	// that is smaller (as on flat, square meshes); typically 5 to 20% larger
+	// than the smallest sphere
+	static BoundingSphere sphere(const float* positions, size_t count, size_t stride);
+
+	// both, over the vertices of mesh, stored in mesh.aabb and mesh.sphere
+	static void compute(Mesh& mesh);
+
+	// the box of the transformed box (Arvo) and a sphere holding the
+	// transformed sphere, for an affine model matrix
+	static Aabb transform(const Aabb& aabb, const glm::mat4& model);
+	static BoundingSphere transform(const BoundingSphere& sphere, const glm::mat4& model);
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// 64-bit multiply-xorshift hash of [begin, end), eight bytes per step; for
+// telling cached data from stale data, not for security
+inline uint64_t checksum(const char* begin, const char* end)
+{
+	const uint64_t kMul = 0x9E3779B97F4A7C15ull;
+	uint64_t h = static_cast<uint64_t>(end - begin) * kMul;
+
+	const char* p = begin;
+	for (; end - p >= 8; p += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, p, 8);
+		h = (h ^ word) * kMul;
+		h ^= h >> 32;
+	}
+
+	uint64_t tail = 0;
+	std::memcpy(&tail, p, end - p);
+	h = (h ^ tail) * kMul;
+	h ^= h >> 29;
+
+	return h;
+}
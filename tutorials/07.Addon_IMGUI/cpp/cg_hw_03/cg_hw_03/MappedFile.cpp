@@ -0,0 +1,127 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: data_(0), size_(0), is_open_(false)
+#ifdef _WIN32
+	, file_(INVALID_HANDLE_VALUE), mapping_(0)
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+
+	file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file_ == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file_, &size))
+	{
+		close();
+		return false;
+	}
+	size_ = static_cast<size_t>(size.QuadPart);
+	is_open_ = true;
+
+	// an empty file cannot be mapped; it is simply an empty range
+	if (size_ == 0)
+		return true;
+
+	mapping_ = CreateFileMappingA(file_, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping_ != 0)
+		data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+
+	if (data_ == 0)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data_)
+		UnmapViewOfFile(data_);
+	if (mapping_)
+		CloseHandle(mapping_);
+	if (file_ != INVALID_HANDLE_VALUE)
+		CloseHandle(file_);
+
+	data_ = 0;
+	size_ = 0;
+	is_open_ = false;
+	mapping_ = 0;
+	file_ = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+	size_ = static_cast<size_t>(st.st_size);
+
+	// an empty file cannot be mapped; it is simply an empty range
+	if (size_ > 0)
+	{
+		void* p = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED)
+		{
+			::close(fd);
+			size_ = 0;
+			return false;
+		}
+		madvise(p, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*>(p);
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	::close(fd);
+	is_open_ = true;
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data_)
+		munmap(const_cast<char*>(data_), size_);
+
+	data_ = 0;
+	size_ = 0;
+	is_open_ = false;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+// The contents are exposed as [begin(), end()) and are not NUL-terminated.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string& filename);
+	void close();
+
+	bool					is_open() const		{ return is_open_; }
+	const char*		begin() const			{ return data_; }
+	const char*		end() const				{ return data_ + size_; }
+	size_t				size() const			{ return size_; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char*	data_;
+	size_t			size_;
+	bool				is_open_;
+
+#ifdef _WIN32
+	void*				file_;			// HANDLE
+	void*				mapping_;		// HANDLE
+#endif
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "VertexFormat.h"
+
+// a coarser index buffer over the vertices of a Mesh
+struct MeshLod
+{
+	std::vector<unsigned int>		ib;				// three indices per triangle
+	float												error;		// deviation from the mesh, relative to its extent
+};
+
+// a run of triangles of Mesh::ib with bounds for culling (see MeshletBuilder)
+struct Meshlet
+{
+	unsigned int	first_index;
+	unsigned int	index_count;
+	unsigned int	vertex_count;				// distinct vertices
+
+	glm::vec3			center;							// bounding sphere
+	float					radius;
+	glm::vec3			cone_axis;					// the normals lie within the cone:
+	float					cone_cutoff;				// sine of its half angle, 1 if it is too wide
+};
+
+// vertex and index data of an Object, as uploaded to GL
+struct Mesh
+{
+	VertexFormat								format;
+	size_t											vertex_count;
+	std::vector<unsigned char>	vb;				// format.buffer_size(vertex_count) bytes
+	std::vector<unsigned int>		ib;				// three indices per triangle
+
+	// quantized positions q in [0, 1] stand for q * position_scale + position_offset;
+	// (0, 0, 0) and (1, 1, 1) for FLOAT positions
+	glm::vec3										position_offset;
+	glm::vec3										position_scale;
+
+	bool												optimized;		// reordered by MeshOptimizer
+
+	// of the decoded positions, set by Bounds::compute
+	Aabb												aabb;
+	BoundingSphere							sphere;
+
+	std::vector<MeshLod>				lods;			// finest first, built by MeshSimplifier
+	std::vector<Meshlet>				meshlets;	// covering ib in order, built by MeshletBuilder
+
+	Mesh() : vertex_count(0), position_offset(0.0f), position_scale(1.0f), optimized(false) {}
+};
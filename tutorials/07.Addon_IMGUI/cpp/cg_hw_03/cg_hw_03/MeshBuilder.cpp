@@ -0,0 +1,531 @@
+#include "MeshBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+	inline unsigned int word_of(float f)
+	{
+		unsigned int w;
+		std::memcpy(&w, &f, sizeof(w));
+		return w;
+	}
+
+	// FNV-1a over the 32-bit words of a vertex
+	inline size_t hash_vertex(const unsigned char* v, size_t bytes)
+	{
+		unsigned int h = 2166136261u;
+		for (size_t i = 0; i < bytes; i += 4)
+		{
+			unsigned int w;
+			std::memcpy(&w, v + i, sizeof(w));
+			h = (h ^ w) * 16777619u;
+		}
+		return h ^ (h >> 15);
+	}
+
+	// Welds bitwise equal vertices of stride elements (a multiple of 4 bytes)
+	// with an open-addressing hash table: vertices receives each distinct
+	// corner in order of first use and indices one entry per corner.
+	template <typename T>
+	void weld(const std::vector<T>& corners, size_t stride, std::vector<T>& vertices,
+		std::vector<unsigned int>& indices)
+	{
+		const size_t count = corners.size() / stride;
+		const size_t bytes = stride * sizeof(T);
+
+		size_t capacity = 16;
+		while (capacity < count * 2)
+			capacity *= 2;
+
+		const unsigned int kEmpty = ~0u;
+		std::vector<unsigned int> table(capacity, kEmpty);
+
+		vertices.clear();
+		indices.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const T* c = &corners[i * stride];
+
+			size_t slot = hash_vertex(reinterpret_cast<const unsigned char*>(c), bytes) & (capacity - 1);
+			while (table[slot] != kEmpty &&
+				std::memcmp(&vertices[table[slot] * stride], c, bytes) != 0)
+			{
+				slot = (slot + 1) & (capacity - 1);
+			}
+
+			if (table[slot] == kEmpty)
+			{
+				table[slot] = static_cast<unsigned int>(vertices.size() / stride);
+				vertices.insert(vertices.end(), c, c + stride);
+			}
+			indices[i] = table[slot];
+		}
+	}
+
+	// area-weighted average of the face normals around each position
+	void smooth_normals(const ObjData& data, std::vector<glm::vec3>& normals)
+	{
+		normals.assign(data.positions.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < data.corners.size(); i += 3)
+		{
+			const int a = data.corners[i].v - 1, b = data.corners[i + 1].v - 1, c = data.corners[i + 2].v - 1;
+			const glm::vec3 n = glm::cross(data.positions[b] - data.positions[a], data.positions[c] - data.positions[a]);
+			normals[a] += n;
+			normals[b] += n;
+			normals[c] += n;
+		}
+
+		for (size_t i = 0; i < normals.size(); ++i)
+		{
+			const float length = glm::length(normals[i]);
+			normals[i] = (length > 0.0f) ? normals[i] / length : glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+	}
+
+	unsigned int pack_color(const glm::vec3& color)
+	{
+		unsigned char rgba[4] = { 255, 255, 255, 255 };
+		for (int i = 0; i < 3; ++i)
+			rgba[i] = static_cast<unsigned char>(std::min(std::max(color[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+
+		unsigned int word;
+		std::memcpy(&word, rgba, sizeof(word));
+		return word;
+	}
+
+	// Lengyel's method: per-triangle texture-space directions summed at the
+	// vertices, then made orthogonal to the normal; w is the handedness.
+	// format is FLOAT and INTERLEAVED.
+	void compute_tangents(const VertexFormat& format, std::vector<float>& vertices,
+		const std::vector<unsigned int>& indices)
+	{
+		const size_t words = format.stride() / sizeof(float);
+		const size_t count = vertices.size() / words;
+		const size_t position = format.offset(VertexFormat::POSITION, count) / sizeof(float);
+		const size_t normal = format.offset(VertexFormat::NORMAL, count) / sizeof(float);
+		const size_t texcoord = format.offset(VertexFormat::TEXCOORD, count) / sizeof(float);
+		const size_t tangent = format.offset(VertexFormat::TANGENT, count) / sizeof(float);
+
+		std::vector<glm::vec3> sdir(count, glm::vec3(0.0f)), tdir(count, glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const float* v[3];
+			for (int k = 0; k < 3; ++k)
+				v[k] = &vertices[indices[i + k] * words];
+
+			const glm::vec3 e1(v[1][position] - v[0][position], v[1][position + 1] - v[0][position + 1], v[1][position + 2] - v[0][position + 2]);
+			const glm::vec3 e2(v[2][position] - v[0][position], v[2][position + 1] - v[0][position + 1], v[2][position + 2] - v[0][position + 2]);
+			const float s1 = v[1][texcoord] - v[0][texcoord], t1 = v[1][texcoord + 1] - v[0][texcoord + 1];
+			const float s2 = v[2][texcoord] - v[0][texcoord], t2 = v[2][texcoord + 1] - v[0][texcoord + 1];
+
+			const float det = s1 * t2 - s2 * t1;
+			if (det == 0.0f)
+				continue;
+
+			const glm::vec3 s = (e1 * t2 - e2 * t1) / det;
+			const glm::vec3 t = (e2 * s1 - e1 * s2) / det;
+			for (int k = 0; k < 3; ++k)
+			{
+				sdir[indices[i + k]] += s;
+				tdir[indices[i + k]] += t;
+			}
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			float* v = &vertices[i * words];
+			const glm::vec3 n(v[normal], v[normal + 1], v[normal + 2]);
+
+			// Gram-Schmidt; without a usable uv mapping any perpendicular will do
+			glm::vec3 t = sdir[i] - n * glm::dot(n, sdir[i]);
+			if (glm::dot(t, t) < 1e-20f)
+				t = glm::cross(n, (std::abs(n.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+			t = glm::normalize(t);
+
+			v[tangent] = t.x;
+			v[tangent + 1] = t.y;
+			v[tangent + 2] = t.z;
+			v[tangent + 3] = (glm::dot(glm::cross(n, t), tdir[i]) < 0.0f) ? -1.0f : 1.0f;
+		}
+	}
+
+	inline float sign_not_zero(float x)
+	{
+		return (x < 0.0f) ? -1.0f : 1.0f;
+	}
+
+	// unit vector -> point of the octahedron unfolded onto [-1, 1]^2; a zero
+	// (vn 0 0 0 is common in exported files) or non-finite normal becomes +z
+	glm::vec2 octahedral(const glm::vec3& n)
+	{
+		const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		if (!(l1 > 0.0f) || !std::isfinite(l1))
+			return glm::vec2(0.0f, 0.0f);
+
+		glm::vec2 p(n.x / l1, n.y / l1);
+		if (n.z < 0.0f)
+		{
+			p = glm::vec2((1.0f - std::abs(p.y)) * sign_not_zero(p.x),
+				(1.0f - std::abs(p.x)) * sign_not_zero(p.y));
+		}
+		return p;
+	}
+
+	glm::vec3 from_octahedral(const glm::vec2& e)
+	{
+		glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+		if (n.z < 0.0f)
+		{
+			n.x = (1.0f - std::abs(e.y)) * sign_not_zero(e.x);
+			n.y = (1.0f - std::abs(e.x)) * sign_not_zero(e.y);
+		}
+		return glm::normalize(n);
+	}
+
+	// NaN, for which the cast would be undefined, becomes 0
+	template <typename T>
+	T snorm(float x, float max)
+	{
+		if (std::isnan(x))
+			return 0;
+		return static_cast<T>(std::floor(std::min(std::max(x, -1.0f), 1.0f) * max + 0.5f));
+	}
+
+	// src in from (FLOAT, INTERLEAVED) -> dst in to (INTERLEAVED, any
+	// encoding), quantizing positions within mesh's position bounds
+	void encode(const VertexFormat& from, const std::vector<float>& src,
+		const VertexFormat& to, const Mesh& mesh, std::vector<unsigned char>& dst)
+	{
+		const size_t words = from.stride() / sizeof(float);
+		const size_t count = src.size() / words;
+		const size_t stride = to.stride();
+
+		dst.assign(stride * count, 0);
+		if (to.encoding == VertexFormat::FLOAT)
+		{
+			if (!src.empty())
+				std::memcpy(dst.data(), src.data(), dst.size());
+			return;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float* s = &src[i * words];
+			unsigned char* d = &dst[i * stride];
+
+			for (int k = 0; k < VertexFormat::kNumAttributes; ++k)
+			{
+				const VertexFormat::Attribute attribute = VertexFormat::attribute(k);
+				if (!from.has(attribute))
+					continue;
+
+				const float* a = s + from.offset(attribute, count) / sizeof(float);
+				unsigned char* b = d + to.offset(attribute, count);
+				switch (attribute)
+				{
+				case VertexFormat::POSITION:
+				{
+					unsigned short q[4] = { 0, 0, 0, 0 };
+					for (int c = 0; c < 3; ++c)
+					{
+						const float t = (a[c] - mesh.position_offset[c]) / mesh.position_scale[c];
+						q[c] = static_cast<unsigned short>(std::floor(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f + 0.5f));
+					}
+					std::memcpy(b, q, sizeof(q));
+					break;
+				}
+				case VertexFormat::NORMAL:
+				{
+					const glm::vec2 e = octahedral(glm::vec3(a[0], a[1], a[2]));
+					if (to.encoding == VertexFormat::QUANTIZED_OCT8)
+					{
+						const signed char q[2] = { snorm<signed char>(e.x, 127.0f), snorm<signed char>(e.y, 127.0f) };
+						std::memcpy(b, q, sizeof(q));
+					}
+					else
+					{
+						const short q[2] = { snorm<short>(e.x, 32767.0f), snorm<short>(e.y, 32767.0f) };
+						std::memcpy(b, q, sizeof(q));
+					}
+					break;
+				}
+				case VertexFormat::TEXCOORD:
+				{
+					const unsigned short q[2] = { MeshBuilder::float_to_half(a[0]), MeshBuilder::float_to_half(a[1]) };
+					std::memcpy(b, q, sizeof(q));
+					break;
+				}
+				case VertexFormat::TANGENT:
+				{
+					const signed char q[4] = {
+						snorm<signed char>(a[0], 127.0f), snorm<signed char>(a[1], 127.0f),
+						snorm<signed char>(a[2], 127.0f), snorm<signed char>(a[3], 127.0f)
+					};
+					std::memcpy(b, q, sizeof(q));
+					break;
+				}
+				case VertexFormat::COLOR:
+					std::memcpy(b, a, 4);
+					break;
+				}
+			}
+		}
+	}
+
+	// rearranges the vertices from one layout of a format to another
+	void convert(const VertexFormat& from, const std::vector<unsigned char>& src,
+		const VertexFormat& to, size_t count, std::vector<unsigned char>& dst)
+	{
+		dst.assign(to.buffer_size(count), 0);
+		for (int i = 0; i < VertexFormat::kNumAttributes; ++i)
+		{
+			const VertexFormat::Attribute attribute = VertexFormat::attribute(i);
+			if (!from.has(attribute))
+				continue;
+
+			const size_t size = from.size(attribute);
+			const unsigned char* s = src.data() + from.offset(attribute, count);
+			unsigned char* d = dst.data() + to.offset(attribute, count);
+			for (size_t k = 0; k < count; ++k, s += from.step(attribute), d += to.step(attribute))
+				std::memcpy(d, s, size);
+		}
+	}
+
+}
+
+const ObjIndex* MeshBuilder::build(const ObjData& data, Mesh& mesh)
+{
+	const VertexFormat format = mesh.format;
+
+	bool missing_normals = false;
+	for (size_t i = 0; i < data.corners.size(); ++i)
+	{
+		const ObjIndex& c = data.corners[i];
+		if (c.v < 1 || c.v > static_cast<int>(data.positions.size()) ||
+			c.vt < 0 || c.vt > static_cast<int>(data.texcoords.size()) ||
+			c.vn < 0 || c.vn > static_cast<int>(data.normals.size()))
+		{
+			return &c;
+		}
+
+		missing_normals = missing_normals || c.vn == 0;
+	}
+
+	std::vector<glm::vec3> smoothed;
+	if (format.has(VertexFormat::NORMAL) && missing_normals)
+		smooth_normals(data, smoothed);
+
+	// the corners as they are drawn, three per triangle, built as
+	// interleaved floats
+	const VertexFormat interleaved(format.attributes, VertexFormat::INTERLEAVED);
+	const size_t words = interleaved.stride() / sizeof(float);
+	const size_t normal = interleaved.offset(VertexFormat::NORMAL, 0) / sizeof(float);
+	const size_t texcoord = interleaved.offset(VertexFormat::TEXCOORD, 0) / sizeof(float);
+	const size_t color = interleaved.offset(VertexFormat::COLOR, 0) / sizeof(float);
+	const unsigned int white = pack_color(ObjData::kDefaultColor);
+
+	std::vector<float> corners(data.corners.size() * words, 0.0f);
+	for (size_t i = 0; i < data.corners.size(); ++i)
+	{
+		const ObjIndex& c = data.corners[i];
+		float* v = &corners[i * words];
+
+		const glm::vec3& p = data.positions[c.v - 1];
+		v[0] = p.x;
+		v[1] = p.y;
+		v[2] = p.z;
+
+		if (format.has(VertexFormat::NORMAL))
+		{
+			const glm::vec3& n = (c.vn > 0) ? data.normals[c.vn - 1] : smoothed[c.v - 1];
+			v[normal] = n.x;
+			v[normal + 1] = n.y;
+			v[normal + 2] = n.z;
+		}
+
+		if (format.has(VertexFormat::TEXCOORD) && c.vt > 0)
+		{
+			v[texcoord] = data.texcoords[c.vt - 1].x;
+			v[texcoord + 1] = data.texcoords[c.vt - 1].y;
+		}
+
+		if (format.has(VertexFormat::COLOR))
+		{
+			const unsigned int rgba = data.colors.empty() ? white : pack_color(data.colors[c.v - 1]);
+			std::memcpy(&v[color], &rgba, sizeof(rgba));
+		}
+	}
+
+	// one vertex per distinct corner instead of three copies per triangle;
+	// tangents are still zero here and are filled in per welded vertex
+	std::vector<float> vertices;
+	weld(corners, words, vertices, mesh.ib);
+
+	if (format.has(VertexFormat::TANGENT))
+		compute_tangents(interleaved, vertices, mesh.ib);
+
+	const size_t count = vertices.size() / words;
+
+	// quantized positions span the bounds of the mesh
+	mesh.position_offset = glm::vec3(0.0f);
+	mesh.position_scale = glm::vec3(1.0f);
+	if (format.encoding != VertexFormat::FLOAT && count > 0)
+	{
+		glm::vec3 lo(vertices[0], vertices[1], vertices[2]), hi = lo;
+		for (size_t i = 1; i < count; ++i)
+		{
+			const glm::vec3 p(vertices[i * words], vertices[i * words + 1], vertices[i * words + 2]);
+			lo = glm::min(lo, p);
+			hi = glm::max(hi, p);
+		}
+
+		mesh.position_offset = lo;
+		for (int c = 0; c < 3; ++c)
+			mesh.position_scale[c] = (hi[c] > lo[c]) ? hi[c] - lo[c] : 1.0f;
+	}
+
+	const VertexFormat encoded(format.attributes, VertexFormat::INTERLEAVED, format.encoding);
+	std::vector<unsigned char> bytes;
+	encode(interleaved, vertices, encoded, mesh, bytes);
+	mesh.vertex_count = count;
+
+	// vertices that differed only below the quantization step are now equal
+	if (format.encoding != VertexFormat::FLOAT)
+	{
+		std::vector<unsigned char> welded;
+		std::vector<unsigned int> remap;
+		weld(bytes, encoded.stride(), welded, remap);
+
+		for (size_t i = 0; i < mesh.ib.size(); ++i)
+			mesh.ib[i] = remap[mesh.ib[i]];
+		bytes.swap(welded);
+		mesh.vertex_count = bytes.size() / encoded.stride();
+	}
+
+	if (format.layout == VertexFormat::INTERLEAVED)
+		mesh.vb.swap(bytes);
+	else
+		convert(encoded, bytes, format, mesh.vertex_count, mesh.vb);
+
+	mesh.optimized = false;
+	return 0;
+}
+
+glm::vec3 MeshBuilder::position(const Mesh& mesh, size_t i)
+{
+	const VertexFormat& format = mesh.format;
+	const unsigned char* p = &mesh.vb[format.offset(VertexFormat::POSITION, mesh.vertex_count) +
+		i * format.step(VertexFormat::POSITION)];
+
+	if (format.encoding == VertexFormat::FLOAT)
+	{
+		float v[3];
+		std::memcpy(v, p, sizeof(v));
+		return glm::vec3(v[0], v[1], v[2]);
+	}
+
+	unsigned short q[3];
+	std::memcpy(q, p, sizeof(q));
+	return glm::vec3(q[0], q[1], q[2]) * (1.0f / 65535.0f) * mesh.position_scale + mesh.position_offset;
+}
+
+glm::vec3 MeshBuilder::normal(const Mesh& mesh, size_t i)
+{
+	const VertexFormat& format = mesh.format;
+	if (!format.has(VertexFormat::NORMAL))
+		return glm::vec3(0.0f, 0.0f, 1.0f);
+
+	const unsigned char* p = &mesh.vb[format.offset(VertexFormat::NORMAL, mesh.vertex_count) +
+		i * format.step(VertexFormat::NORMAL)];
+
+	switch (format.encoding)
+	{
+	case VertexFormat::FLOAT:
+	{
+		float v[3];
+		std::memcpy(v, p, sizeof(v));
+		return glm::vec3(v[0], v[1], v[2]);
+	}
+	case VertexFormat::QUANTIZED:
+	{
+		short q[2];
+		std::memcpy(q, p, sizeof(q));
+		return from_octahedral(glm::vec2(std::max(q[0] / 32767.0f, -1.0f), std::max(q[1] / 32767.0f, -1.0f)));
+	}
+	case VertexFormat::QUANTIZED_OCT8:
+	{
+		signed char q[2];
+		std::memcpy(q, p, sizeof(q));
+		return from_octahedral(glm::vec2(std::max(q[0] / 127.0f, -1.0f), std::max(q[1] / 127.0f, -1.0f)));
+	}
+	}
+	return glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+glm::vec2 MeshBuilder::texcoord(const Mesh& mesh, size_t i)
+{
+	const VertexFormat& format = mesh.format;
+	if (!format.has(VertexFormat::TEXCOORD))
+		return glm::vec2(0.0f);
+
+	const unsigned char* p = &mesh.vb[format.offset(VertexFormat::TEXCOORD, mesh.vertex_count) +
+		i * format.step(VertexFormat::TEXCOORD)];
+
+	if (format.encoding == VertexFormat::FLOAT)
+	{
+		float v[2];
+		std::memcpy(v, p, sizeof(v));
+		return glm::vec2(v[0], v[1]);
+	}
+
+	unsigned short q[2];
+	std::memcpy(q, p, sizeof(q));
+	return glm::vec2(half_to_float(q[0]), half_to_float(q[1]));
+}
+
+unsigned short MeshBuilder::float_to_half(float f)
+{
+	const unsigned int x = word_of(f);
+	const unsigned int sign = (x >> 16) & 0x8000;
+	const unsigned int abs = x & 0x7FFFFFFF;
+
+	if (abs >= 0x7F800000)					// inf, nan
+		return static_cast<unsigned short>(sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0));
+	if (abs >= 0x477FF000)					// rounds beyond the largest half
+		return static_cast<unsigned short>(sign | 0x7C00);
+	if (abs < 0x38800000)						// subnormal half (or zero)
+	{
+		// scaling by 2^-24 (the subnormal half step) rounds to nearest even
+		float magnitude;
+		std::memcpy(&magnitude, &abs, sizeof(magnitude));
+		return static_cast<unsigned short>(sign | static_cast<unsigned int>(std::nearbyint(magnitude * 16777216.0f)));
+	}
+
+	// rebias the exponent and round the 13 dropped mantissa bits to nearest even
+	const unsigned int rebased = abs - 0x38000000;
+	const unsigned int rounded = rebased + 0xFFF + ((rebased >> 13) & 1);
+	return static_cast<unsigned short>(sign | (rounded >> 13));
+}
+
+float MeshBuilder::half_to_float(unsigned short h)
+{
+	const unsigned int sign = static_cast<unsigned int>(h & 0x8000) << 16;
+	const unsigned int exponent = (h >> 10) & 0x1F;
+	const unsigned int mantissa = h & 0x3FF;
+
+	float f;
+	if (exponent == 0)
+	{
+		f = mantissa / 16777216.0f;			// subnormal: mantissa * 2^-24
+		return sign ? -f : f;
+	}
+
+	const unsigned int x = (exponent == 31)
+		? sign | 0x7F800000 | (mantissa << 13)
+		: sign | ((exponent + 112) << 23) | (mantissa << 13);
+	std::memcpy(&f, &x, sizeof(f));
+	return f;
+}
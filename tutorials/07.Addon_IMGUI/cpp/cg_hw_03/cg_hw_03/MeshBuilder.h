@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "ObjParser.h"
+
+// Turns parsed OBJ records into a welded, indexed Mesh in a given format.
+class MeshBuilder
+{
+public:
+	// builds mesh in mesh.format; returns 0 on success or the first corner with
+	// an index out of range. Normals missing from the file are smoothed from
+	// the faces, texcoords default to (0, 0), colors to white and tangents are
+	// derived from normals and texcoords.
+	static const ObjIndex* build(const ObjData& data, Mesh& mesh);
+
+	// decoded attributes of vertex i
+	static glm::vec3 position(const Mesh& mesh, size_t i);
+	static glm::vec3 normal(const Mesh& mesh, size_t i);
+	static glm::vec2 texcoord(const Mesh& mesh, size_t i);
+
+	// IEEE half precision, rounded to nearest even
+	static unsigned short float_to_half(float f);
+	static float half_to_float(unsigned short h);
+};
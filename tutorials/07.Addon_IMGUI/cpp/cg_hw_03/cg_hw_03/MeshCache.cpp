@@ -0,0 +1,210 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "Checksum.h"
+#include "MappedFile.h"
+
+namespace {
+
+	bool file_stamp(const std::string& filename, uint64_t& size, int64_t& time)
+	{
+		struct stat st;
+		if (stat(filename.c_str(), &st) != 0)
+			return false;
+
+		size = static_cast<uint64_t>(st.st_size);
+		time = static_cast<int64_t>(st.st_mtime);
+		return true;
+	}
+
+	uint64_t align(uint64_t offset)
+	{
+		return (offset + MeshCache::kAlignment - 1) / MeshCache::kAlignment * MeshCache::kAlignment;
+	}
+
+	uint32_t format_id(const VertexFormat& format)
+	{
+		return format.attributes | (static_cast<uint32_t>(format.layout) << 16) |
+			(static_cast<uint32_t>(format.encoding) << 24);
+	}
+
+	uint32_t mesh_flags(const Mesh& mesh)
+	{
+		return mesh.optimized ? MeshCache::kOptimized : 0;
+	}
+
+	void write_padding(std::ofstream& file, uint64_t offset)
+	{
+		static const char zeros[MeshCache::kAlignment] = {};
+		file.write(zeros, align(offset) - offset);
+	}
+
+}
+
+bool MeshCache::load(const std::string& cache_file, const std::string& source_file, Mesh& mesh)
+{
+	const VertexFormat& format = mesh.format;
+
+	MappedFile cache;
+	if (!cache.open(cache_file) || cache.size() < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, cache.begin(), sizeof(header));
+
+	if (std::memcmp(header.magic, "MESH", 4) != 0 ||
+		header.version != kVersion ||
+		header.header_size != sizeof(MeshCacheHeader) ||
+		header.vertex_size != format.stride() ||
+		header.vertex_format != format_id(format) ||
+		header.mesh_flags != mesh_flags(mesh) ||
+		(header.index_size != 2 && header.index_size != 4))
+	{
+		return false;
+	}
+
+	// blobs must lie inside the file
+	const uint64_t size = cache.size();
+	if (header.vertex_offset > size ||
+		header.vertex_count > (size - header.vertex_offset) / header.vertex_size ||
+		format.buffer_size(header.vertex_count) > size - header.vertex_offset ||
+		header.index_offset > size ||
+		header.index_count > (size - header.index_offset) / header.index_size ||
+		header.index_count % 3 != 0)
+	{
+		return false;
+	}
+
+	uint64_t source_size;
+	int64_t source_time;
+	if (!file_stamp(source_file, source_size, source_time))
+		return false;
+
+	// a touched but unchanged source keeps its cache
+	if (source_size != header.source_size || source_time != header.source_time)
+	{
+		MappedFile source;
+		if (!source.open(source_file) ||
+			checksum(source.begin(), source.end()) != header.source_checksum)
+		{
+			return false;
+		}
+	}
+
+	std::vector<unsigned int> ib(header.index_count);
+	if (header.index_size == 4)
+	{
+		if (!ib.empty())
+			std::memcpy(ib.data(), cache.begin() + header.index_offset, ib.size() * sizeof(uint32_t));
+	}
+	else
+	{
+		const char* indices = cache.begin() + header.index_offset;
+		for (size_t i = 0; i < ib.size(); ++i)
+		{
+			uint16_t index;
+			std::memcpy(&index, indices + 2 * i, 2);
+			ib[i] = index;
+		}
+	}
+
+	// the size and time match skips the checksum, so a damaged or stale
+	// cache is only caught here, before anything reads vb through ib
+	for (size_t i = 0; i < ib.size(); ++i)
+	{
+		if (ib[i] >= header.vertex_count)
+			return false;
+	}
+
+	mesh.vertex_count = header.vertex_count;
+	mesh.vb.assign(cache.begin() + header.vertex_offset,
+		cache.begin() + header.vertex_offset + format.buffer_size(mesh.vertex_count));
+	mesh.position_offset = glm::vec3(header.position_offset[0], header.position_offset[1], header.position_offset[2]);
+	mesh.position_scale = glm::vec3(header.position_scale[0], header.position_scale[1], header.position_scale[2]);
+	mesh.ib.swap(ib);
+
+	return true;
+}
+
+bool MeshCache::save(const std::string& cache_file, const std::string& source_file,
+	const char* begin, const char* end,
+	const Mesh& mesh)
+{
+	const VertexFormat& format = mesh.format;
+	const std::vector<unsigned char>& vb = mesh.vb;
+	const std::vector<unsigned int>& ib = mesh.ib;
+
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, "MESH", 4);
+	header.version = kVersion;
+	header.header_size = sizeof(MeshCacheHeader);
+	header.vertex_size = format.stride();
+	header.index_size = (mesh.vertex_count <= 0x10000) ? 2 : 4;
+	header.vertex_format = format_id(format);
+	header.mesh_flags = mesh_flags(mesh);
+
+	if (!file_stamp(source_file, header.source_size, header.source_time))
+		return false;
+	header.source_checksum = checksum(begin, end);
+
+	header.vertex_count = mesh.vertex_count;
+	header.vertex_offset = align(sizeof(MeshCacheHeader));
+	header.index_count = ib.size();
+	header.index_offset = align(header.vertex_offset + vb.size());
+	for (int i = 0; i < 3; ++i)
+	{
+		header.position_offset[i] = mesh.position_offset[i];
+		header.position_scale[i] = mesh.position_scale[i];
+	}
+
+	// written under a temporary name so that a reader never maps a partial file
+	const std::string tmp_file = cache_file + ".tmp";
+	std::ofstream file(tmp_file.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "failed to write mesh cache: " << cache_file << std::endl;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	write_padding(file, sizeof(header));
+
+	file.write(reinterpret_cast<const char*>(vb.data()), vb.size());
+	write_padding(file, header.vertex_offset + vb.size());
+
+	if (header.index_size == 4)
+	{
+		file.write(reinterpret_cast<const char*>(ib.data()), ib.size() * sizeof(uint32_t));
+	}
+	else
+	{
+		std::vector<uint16_t> ib16(ib.begin(), ib.end());
+		file.write(reinterpret_cast<const char*>(ib16.data()), ib16.size() * sizeof(uint16_t));
+	}
+
+	file.close();
+	if (!file)
+	{
+		std::cerr << "failed to write mesh cache: " << cache_file << std::endl;
+		std::remove(tmp_file.c_str());
+		return false;
+	}
+
+	std::remove(cache_file.c_str());
+	if (std::rename(tmp_file.c_str(), cache_file.c_str()) != 0)
+	{
+		std::cerr << "failed to write mesh cache: " << cache_file << std::endl;
+		std::remove(tmp_file.c_str());
+		return false;
+	}
+
+	return true;
+}
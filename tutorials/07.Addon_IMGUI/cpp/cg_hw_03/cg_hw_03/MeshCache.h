@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "Mesh.h"
+
+// Binary cache of a welded mesh next to its source file.
+//
+// Layout (native byte order): a MeshCacheHeader, then the vertex blob and the
+// index blob, each starting at a multiple of kAlignment. The header records
+// the size, modification time and checksum of the source file; a cache whose
+// size and time still match is used as is, otherwise the source is hashed and
+// compared with the stored checksum.
+struct MeshCacheHeader
+{
+	char			magic[4];					// "MESH"
+	uint32_t	version;
+	uint32_t	header_size;
+	uint32_t	vertex_size;			// VertexFormat::stride()
+	uint32_t	index_size;				// 2 or 4
+	uint32_t	vertex_format;		// VertexFormat attributes | layout << 16 | encoding << 24
+	uint32_t	mesh_flags;				// kOptimized
+
+	uint64_t	source_size;
+	int64_t		source_time;
+	uint64_t	source_checksum;
+
+	uint64_t	vertex_count;
+	uint64_t	vertex_offset;		// from the start of the file
+	uint64_t	index_count;
+	uint64_t	index_offset;
+
+	float			position_offset[3];
+	float			position_scale[3];
+};
+
+class MeshCache
+{
+public:
+	static const uint32_t kVersion = 5;		// 4: quantized encodings, 5: mesh_flags
+	static const uint32_t kOptimized = 1;	// Mesh::optimized
+	static const uint32_t kAlignment = 64;
+
+	// fills mesh from cache_file if it is valid for source_file and was
+	// written with mesh.format and mesh.optimized
+	static bool load(const std::string& cache_file, const std::string& source_file, Mesh& mesh);
+
+	// writes cache_file for the source whose contents are [begin, end)
+	static bool save(const std::string& cache_file, const std::string& source_file,
+		const char* begin, const char* end, const Mesh& mesh);
+};
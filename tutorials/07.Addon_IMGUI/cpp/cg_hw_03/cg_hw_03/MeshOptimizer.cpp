@@ -0,0 +1,231 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+	// scoring of Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriangleScore = 0.75f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+
+	const unsigned int kMaxValence = 64;		// more triangles score the same
+
+	// vertex scores by position in the cache and by triangles left to draw
+	struct ScoreTables
+	{
+		float	cache[MeshOptimizer::kCacheSize];
+		float	valence[kMaxValence + 1];
+
+		ScoreTables()
+		{
+			// the vertices of the last triangle get a fixed score, so that the
+			// next triangle does not simply reuse its most recent edge
+			for (unsigned int i = 0; i < MeshOptimizer::kCacheSize; ++i)
+			{
+				cache[i] = (i < 3) ? kLastTriangleScore
+					: std::pow(1.0f - float(i - 3) / (MeshOptimizer::kCacheSize - 3), kCacheDecayPower);
+			}
+
+			// few triangles left: draw them soon rather than strand the vertex
+			valence[0] = 0.0f;
+			for (unsigned int i = 1; i <= kMaxValence; ++i)
+				valence[i] = kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+		}
+	};
+
+	float vertex_score(const ScoreTables& tables, int cache_position, unsigned int remaining)
+	{
+		if (remaining == 0)
+			return -1.0f;
+
+		const float score = (cache_position < 0) ? 0.0f : tables.cache[cache_position];
+		return score + tables.valence[std::min(remaining, kMaxValence)];
+	}
+
+}
+
+void MeshOptimizer::optimize(Mesh& mesh)
+{
+	optimize_vertex_cache(mesh.ib, mesh.vertex_count);
+	optimize_vertex_fetch(mesh);
+	mesh.optimized = true;
+}
+
+// Greedy: each step draws the highest scoring triangle among those of the
+// cached vertices, where a triangle scores the sum of its vertex scores. Only
+// scores around the cache change per step, which keeps it linear.
+void MeshOptimizer::optimize_vertex_cache(std::vector<unsigned int>& ib, size_t vertex_count)
+{
+	static const ScoreTables tables;
+
+	const size_t triangle_count = ib.size() / 3;
+	if (triangle_count == 0)
+		return;
+
+	// triangles not drawn yet of each vertex: triangles[first[v], first[v] + remaining[v])
+	std::vector<unsigned int> remaining(vertex_count, 0);
+	for (size_t i = 0; i < 3 * triangle_count; ++i)
+		++remaining[ib[i]];
+
+	std::vector<unsigned int> first(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; ++v)
+		first[v + 1] = first[v] + remaining[v];
+
+	std::vector<unsigned int> triangles(3 * triangle_count);
+	std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+	for (size_t i = 0; i < 3 * triangle_count; ++i)
+		triangles[fill[ib[i]]++] = static_cast<unsigned int>(i / 3);
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> score(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v)
+		score[v] = vertex_score(tables, -1, remaining[v]);
+
+	std::vector<bool> drawn(triangle_count, false);
+	std::vector<unsigned int> result;
+	result.reserve(3 * triangle_count);
+
+	// the drawn triangle's vertices go to the front; the cache may overflow
+	// by those three while the scores are updated
+	unsigned int cache[kCacheSize + 3];
+	unsigned int next_cache[kCacheSize + 3];
+	size_t cache_count = 0;
+
+	size_t best = 0;
+	float best_score = -1.0f;
+	for (size_t t = 0; t < triangle_count; ++t)
+	{
+		const float s = score[ib[3 * t]] + score[ib[3 * t + 1]] + score[ib[3 * t + 2]];
+		if (s > best_score)
+		{
+			best = t;
+			best_score = s;
+		}
+	}
+
+	size_t next_undrawn = 0;
+	while (result.size() < 3 * triangle_count)
+	{
+		// dead end: no cached vertex has triangles left
+		if (best_score < 0.0f)
+		{
+			while (drawn[next_undrawn])
+				++next_undrawn;
+			best = next_undrawn;
+		}
+
+		const unsigned int* triangle = &ib[3 * best];
+		result.insert(result.end(), triangle, triangle + 3);
+		drawn[best] = true;
+
+		size_t n = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned int v = triangle[k];
+			if (std::find(next_cache, next_cache + n, v) == next_cache + n)
+				next_cache[n++] = v;
+
+			// the triangle leaves the list of v
+			unsigned int* list = &triangles[first[v]];
+			unsigned int* end = list + remaining[v];
+			std::swap(*std::find(list, end, static_cast<unsigned int>(best)), end[-1]);
+			--remaining[v];
+		}
+
+		for (size_t i = 0; i < cache_count; ++i)
+		{
+			const unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				next_cache[n++] = v;
+		}
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			const unsigned int v = next_cache[i];
+			cache_position[v] = (i < kCacheSize) ? static_cast<int>(i) : -1;
+			score[v] = vertex_score(tables, cache_position[v], remaining[v]);
+		}
+
+		cache_count = std::min<size_t>(n, kCacheSize);
+		std::copy(next_cache, next_cache + cache_count, cache);
+
+		best_score = -1.0f;
+		for (size_t i = 0; i < cache_count; ++i)
+		{
+			const unsigned int v = cache[i];
+			for (unsigned int j = first[v]; j < first[v] + remaining[v]; ++j)
+			{
+				const unsigned int t = triangles[j];
+				const float s = score[ib[3 * t]] + score[ib[3 * t + 1]] + score[ib[3 * t + 2]];
+				if (s > best_score)
+				{
+					best = t;
+					best_score = s;
+				}
+			}
+		}
+	}
+
+	std::copy(result.begin(), result.end(), ib.begin());
+}
+
+void MeshOptimizer::optimize_vertex_fetch(Mesh& mesh)
+{
+	const VertexFormat& format = mesh.format;
+	const size_t old_count = mesh.vertex_count;
+
+	std::vector<unsigned int> remap(old_count, ~0u);
+	unsigned int count = 0;
+	for (size_t i = 0; i < mesh.ib.size(); ++i)
+	{
+		unsigned int& index = remap[mesh.ib[i]];
+		if (index == ~0u)
+			index = count++;
+		mesh.ib[i] = index;
+	}
+
+	std::vector<unsigned char> vb(format.buffer_size(count), 0);
+	for (int i = 0; i < VertexFormat::kNumAttributes; ++i)
+	{
+		const VertexFormat::Attribute attribute = VertexFormat::attribute(i);
+		if (!format.has(attribute))
+			continue;
+
+		const size_t size = format.size(attribute);
+		const size_t step = format.step(attribute);
+		const unsigned char* src = mesh.vb.data() + format.offset(attribute, old_count);
+		unsigned char* dst = vb.data() + format.offset(attribute, count);
+		for (size_t v = 0; v < old_count; ++v)
+		{
+			if (remap[v] != ~0u)
+				std::memcpy(dst + remap[v] * step, src + v * step, size);
+		}
+	}
+
+	mesh.vb.swap(vb);
+	mesh.vertex_count = count;
+}
+
+float MeshOptimizer::acmr(const std::vector<unsigned int>& ib, unsigned int cache_size)
+{
+	const size_t triangle_count = ib.size() / 3;
+	if (triangle_count == 0)
+		return 0.0f;
+
+	// entered[v]: number of misses when v was last transformed, 0 if never;
+	// the FIFO holds the last cache_size vertices transformed
+	std::vector<size_t> entered(*std::max_element(ib.begin(), ib.end()) + 1, 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < 3 * triangle_count; ++i)
+	{
+		size_t& e = entered[ib[i]];
+		if (e == 0 || misses - e >= cache_size)
+			e = ++misses;
+	}
+
+	return static_cast<float>(misses) / triangle_count;
+}
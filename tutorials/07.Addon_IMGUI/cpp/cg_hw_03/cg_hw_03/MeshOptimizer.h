@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+
+#include "Mesh.h"
+
+// Post-load reordering of a Mesh for the GPU. Triangles are reordered for the
+// post-transform vertex cache with Forsyth's linear-speed algorithm, then the
+// vertices are renumbered in order of first use so that vertex fetches walk
+// the buffer forward. Neither pass changes what is drawn.
+class MeshOptimizer
+{
+public:
+	// vertices of the LRU cache modeled by optimize_vertex_cache
+	static const unsigned int kCacheSize = 32;
+
+	// both passes; sets mesh.optimized
+	static void optimize(Mesh& mesh);
+
+	// reorders the triangles of ib, which index vertex_count vertices
+	static void optimize_vertex_cache(std::vector<unsigned int>& ib, size_t vertex_count);
+
+	// reorders the vertices of mesh by first use in mesh.ib and drops unused ones
+	static void optimize_vertex_fetch(Mesh& mesh);
+
+	// average cache miss ratio: transformed vertices per triangle with a FIFO
+	// cache of cache_size vertices, from 0.5 (ideal grid) to 3 (no reuse)
+	static float acmr(const std::vector<unsigned int>& ib, unsigned int cache_size = 16);
+};
@@ -0,0 +1,505 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <queue>
+#include <thread>
+
+#include "MeshBuilder.h"
+#include "MeshOptimizer.h"
+
+namespace {
+
+	// squared attribute differences in units of squared relative distance: a
+	// normal turned by 90 degrees weighs like moving 7% of the extent
+	const float kNormalWeight = 0.0025f;
+	const float kTexcoordWeight = 0.01f;
+
+	// borders are held in place by planes through them, perpendicular to
+	// their face, weighted by their squared length times this
+	const float kBorderWeight = 10.0f;
+
+	// squared distance to a set of weighted planes as a symmetric 4x4 matrix,
+	// with the summed weights
+	struct Quadric
+	{
+		double	a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+		double	weight;
+
+		Quadric()
+			: a00(0), a01(0), a02(0), a03(0), a11(0), a12(0), a13(0), a22(0), a23(0), a33(0), weight(0)
+		{}
+
+		// the plane dot(n, p) + d = 0, n of unit length
+		Quadric(const glm::vec3& n, float d, double w)
+			: a00(w * n.x * n.x), a01(w * n.x * n.y), a02(w * n.x * n.z), a03(w * n.x * d),
+				a11(w * n.y * n.y), a12(w * n.y * n.z), a13(w * n.y * d),
+				a22(w * n.z * n.z), a23(w * n.z * d), a33(w * d * d), weight(w)
+		{}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23; a33 += q.a33;
+			weight += q.weight;
+			return *this;
+		}
+
+		// weighted mean squared distance of p to the planes
+		double error(const glm::vec3& p) const
+		{
+			if (weight <= 0.0)
+				return 0.0;
+
+			const double x = p.x, y = p.y, z = p.z;
+			const double e = a00 * x * x + a11 * y * y + a22 * z * z + a33 +
+				2.0 * (a01 * x * y + a02 * x * z + a12 * y * z + a03 * x + a13 * y + a23 * z);
+			return std::max(e, 0.0) / weight;
+		}
+	};
+
+	struct Collapse
+	{
+		float					cost;
+		unsigned int	valence;							// faces around both ends
+		unsigned int	from, to;							// position classes
+		unsigned int	from_version, to_version;
+
+		// cheapest on top of the queue. Equal costs (flat areas) go to the
+		// smaller fans, so that no vertex gathers a fan of the whole area, then
+		// by class so that the order of collapses is always the same.
+		bool operator<(const Collapse& other) const
+		{
+			if (cost != other.cost)
+				return cost > other.cost;
+			if (valence != other.valence)
+				return valence > other.valence;
+			if (from != other.from)
+				return from > other.from;
+			return to > other.to;
+		}
+	};
+
+	// the collapse state of one mesh, kept across its levels. Vertices at the
+	// same position form a class; edges are collapsed between classes.
+	class Simplifier
+	{
+	public:
+		explicit Simplifier(const Mesh& mesh);
+
+		// collapses edges until at most target triangles are left or no edge
+		// can go, and returns the triangles left
+		void simplify(size_t target, MeshLod& lod);
+
+	private:
+		typedef std::vector<std::pair<unsigned int, unsigned int> > VertexMap;
+
+		float attribute_cost(unsigned int from, unsigned int to, VertexMap* targets) const;
+		float cost(unsigned int from, unsigned int to) const;
+		void push_edge(unsigned int a, unsigned int b);
+		bool flips(unsigned int from, unsigned int to) const;
+		void collapse(unsigned int from, unsigned int to);
+
+		bool												has_normal_, has_texcoord_;
+		std::vector<glm::vec3>			normal_;							// per vertex
+		std::vector<glm::vec2>			texcoord_;						// per vertex
+		std::vector<unsigned int>		class_of_;						// per vertex
+		std::vector<unsigned int>		uses_;								// per vertex, by live triangles
+
+		std::vector<glm::vec3>			position_;						// per class, within the unit cube
+		std::vector<unsigned int>		class_first_;					// class_vertices_[class_first_[c], class_first_[c + 1])
+		std::vector<unsigned int>		class_vertices_;
+		std::vector<std::vector<unsigned int> >	triangles_;	// per class, live or not
+		std::vector<Quadric>				quadric_;
+		std::vector<unsigned int>		version_;							// bumped by every change of the class
+		std::vector<bool>						collapsed_;
+
+		std::vector<unsigned int>		ib_;
+		std::vector<bool>						alive_;								// per triangle
+		size_t											live_;
+
+		std::priority_queue<Collapse>	queue_;
+		float												error_;								// largest so far
+	};
+
+	Simplifier::Simplifier(const Mesh& mesh)
+		: has_normal_(mesh.format.has(VertexFormat::NORMAL)),
+			has_texcoord_(mesh.format.has(VertexFormat::TEXCOORD)),
+			ib_(mesh.ib), alive_(mesh.ib.size() / 3, false), live_(0), error_(0.0f)
+	{
+		const size_t count = mesh.vertex_count;
+
+		// positions scaled into the unit cube, so that errors are relative
+		std::vector<glm::vec3> positions(count);
+		glm::vec3 lo(0.0f), hi(0.0f);
+		for (size_t i = 0; i < count; ++i)
+		{
+			positions[i] = MeshBuilder::position(mesh, i);
+			lo = (i == 0) ? positions[i] : glm::min(lo, positions[i]);
+			hi = (i == 0) ? positions[i] : glm::max(hi, positions[i]);
+		}
+		const float extent = std::max(std::max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z);
+		const float scale = (extent > 0.0f) ? 1.0f / extent : 1.0f;
+		for (size_t i = 0; i < count; ++i)
+			positions[i] = (positions[i] - lo) * scale;
+
+		if (has_normal_)
+		{
+			normal_.resize(count);
+			for (size_t i = 0; i < count; ++i)
+				normal_[i] = MeshBuilder::normal(mesh, i);
+		}
+		// texcoords scaled the same way, since tiled ones run far beyond [0, 1]
+		if (has_texcoord_)
+		{
+			texcoord_.resize(count);
+			glm::vec2 t_lo(0.0f), t_hi(0.0f);
+			for (size_t i = 0; i < count; ++i)
+			{
+				texcoord_[i] = MeshBuilder::texcoord(mesh, i);
+				t_lo = (i == 0) ? texcoord_[i] : glm::min(t_lo, texcoord_[i]);
+				t_hi = (i == 0) ? texcoord_[i] : glm::max(t_hi, texcoord_[i]);
+			}
+			const float t_extent = std::max(t_hi.x - t_lo.x, t_hi.y - t_lo.y);
+			const float t_scale = (t_extent > 0.0f) ? 1.0f / t_extent : 1.0f;
+			for (size_t i = 0; i < count; ++i)
+				texcoord_[i] = (texcoord_[i] - t_lo) * t_scale;
+		}
+
+		// classes in order of position, so that their numbering is fixed
+		std::vector<unsigned int> order(count);
+		for (size_t i = 0; i < count; ++i)
+			order[i] = static_cast<unsigned int>(i);
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+			const glm::vec3& p = positions[a];
+			const glm::vec3& q = positions[b];
+			if (p.x != q.x) return p.x < q.x;
+			if (p.y != q.y) return p.y < q.y;
+			if (p.z != q.z) return p.z < q.z;
+			return a < b;
+		});
+
+		class_of_.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const unsigned int v = order[i];
+			if (i == 0 || positions[v] != positions[order[i - 1]])
+			{
+				class_first_.push_back(static_cast<unsigned int>(i));
+				position_.push_back(positions[v]);
+			}
+			class_of_[v] = static_cast<unsigned int>(position_.size() - 1);
+		}
+		class_first_.push_back(static_cast<unsigned int>(count));
+		class_vertices_.swap(order);
+
+		const size_t classes = position_.size();
+		triangles_.resize(classes);
+		quadric_.resize(classes);
+		version_.assign(classes, 0);
+		collapsed_.assign(classes, false);
+		uses_.assign(count, 0);
+
+		// every face adds its plane to its corners, weighted by its area;
+		// faces with two corners at the same position are dropped
+		struct Edge
+		{
+			unsigned int	a, b, triangle;
+			bool operator<(const Edge& other) const
+			{
+				return a != other.a ? a < other.a : b != other.b ? b < other.b : triangle < other.triangle;
+			}
+		};
+		std::vector<Edge> edges;
+
+		for (size_t t = 0; t < alive_.size(); ++t)
+		{
+			const unsigned int c[3] = { class_of_[ib_[3 * t]], class_of_[ib_[3 * t + 1]], class_of_[ib_[3 * t + 2]] };
+			if (c[0] == c[1] || c[1] == c[2] || c[2] == c[0])
+				continue;
+
+			alive_[t] = true;
+			++live_;
+
+			glm::vec3 n = glm::cross(position_[c[1]] - position_[c[0]], position_[c[2]] - position_[c[0]]);
+			const float length = glm::length(n);
+			if (length > 0.0f)
+				n /= length;
+			const Quadric plane(n, -glm::dot(n, position_[c[0]]), 0.5 * length);
+
+			for (int k = 0; k < 3; ++k)
+			{
+				++uses_[ib_[3 * t + k]];
+				triangles_[c[k]].push_back(static_cast<unsigned int>(t));
+				quadric_[c[k]] += plane;
+
+				const Edge edge = { std::min(c[k], c[(k + 1) % 3]), std::max(c[k], c[(k + 1) % 3]),
+					static_cast<unsigned int>(t) };
+				edges.push_back(edge);
+			}
+		}
+
+		// an edge of a single face is a border
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size(); )
+		{
+			size_t j = i + 1;
+			while (j < edges.size() && edges[j].a == edges[i].a && edges[j].b == edges[i].b)
+				++j;
+
+			const Edge& edge = edges[i];
+			if (j == i + 1)
+			{
+				const unsigned int* tri = &ib_[3 * edge.triangle];
+				const glm::vec3 normal = glm::cross(position_[class_of_[tri[1]]] - position_[class_of_[tri[0]]],
+					position_[class_of_[tri[2]]] - position_[class_of_[tri[0]]]);
+				const glm::vec3 e = position_[edge.b] - position_[edge.a];
+
+				glm::vec3 n = glm::cross(e, normal);
+				const float length = glm::length(n);
+				if (length > 0.0f)
+				{
+					n /= length;
+					const Quadric plane(n, -glm::dot(n, position_[edge.a]), kBorderWeight * glm::dot(e, e));
+					quadric_[edge.a] += plane;
+					quadric_[edge.b] += plane;
+				}
+			}
+
+			push_edge(edge.a, edge.b);
+			i = j;
+		}
+	}
+
+	// the largest attribute difference between a used vertex of from and the
+	// closest vertex of to, which is what it becomes (stored in targets)
+	float Simplifier::attribute_cost(unsigned int from, unsigned int to, VertexMap* targets) const
+	{
+		float cost = 0.0f;
+		for (unsigned int i = class_first_[from]; i < class_first_[from + 1]; ++i)
+		{
+			const unsigned int u = class_vertices_[i];
+			if (uses_[u] == 0)
+				continue;
+
+			unsigned int best = class_vertices_[class_first_[to]];
+			float best_cost = -1.0f;
+			for (unsigned int j = class_first_[to]; j < class_first_[to + 1]; ++j)
+			{
+				const unsigned int v = class_vertices_[j];
+				float c = 0.0f;
+				if (has_normal_)
+				{
+					const glm::vec3 d = normal_[u] - normal_[v];
+					c += kNormalWeight * glm::dot(d, d);
+				}
+				if (has_texcoord_)
+				{
+					const glm::vec2 d = texcoord_[u] - texcoord_[v];
+					c += kTexcoordWeight * glm::dot(d, d);
+				}
+
+				if (best_cost < 0.0f || c < best_cost)
+				{
+					best = v;
+					best_cost = c;
+				}
+			}
+
+			cost = std::max(cost, best_cost);
+			if (targets)
+				targets->push_back(std::make_pair(u, best));
+		}
+
+		return cost;
+	}
+
+	float Simplifier::cost(unsigned int from, unsigned int to) const
+	{
+		Quadric q = quadric_[from];
+		q += quadric_[to];
+		return static_cast<float>(q.error(position_[to])) + attribute_cost(from, to, 0);
+	}
+
+	// queues the cheaper direction of the edge
+	void Simplifier::push_edge(unsigned int a, unsigned int b)
+	{
+		const float ab = cost(a, b);
+		const float ba = cost(b, a);
+
+		const unsigned int valence = static_cast<unsigned int>(triangles_[a].size() + triangles_[b].size());
+		const Collapse collapse = (ab <= ba)
+			? Collapse{ ab, valence, a, b, version_[a], version_[b] }
+			: Collapse{ ba, valence, b, a, version_[b], version_[a] };
+		queue_.push(collapse);
+	}
+
+	// whether moving from onto to turns a remaining face over
+	bool Simplifier::flips(unsigned int from, unsigned int to) const
+	{
+		const std::vector<unsigned int>& triangles = triangles_[from];
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			const unsigned int t = triangles[i];
+			if (!alive_[t])
+				continue;
+
+			glm::vec3 p[3], q[3];
+			bool dies = false;
+			for (int k = 0; k < 3; ++k)
+			{
+				const unsigned int c = class_of_[ib_[3 * t + k]];
+				dies = dies || c == to;
+				p[k] = position_[c];
+				q[k] = (c == from) ? position_[to] : p[k];
+			}
+			if (dies)
+				continue;
+
+			const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			const glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+			if (glm::dot(before, after) <= 0.0f)
+				return true;
+		}
+
+		return false;
+	}
+
+	void Simplifier::collapse(unsigned int from, unsigned int to)
+	{
+		VertexMap targets;
+		attribute_cost(from, to, &targets);
+
+		std::vector<unsigned int>& triangles = triangles_[from];
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			const unsigned int t = triangles[i];
+			if (!alive_[t])
+				continue;
+
+			unsigned int* tri = &ib_[3 * t];
+			if (class_of_[tri[0]] == to || class_of_[tri[1]] == to || class_of_[tri[2]] == to)
+			{
+				alive_[t] = false;
+				--live_;
+				for (int k = 0; k < 3; ++k)
+					--uses_[tri[k]];
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				if (class_of_[tri[k]] != from)
+					continue;
+
+				size_t j = 0;
+				while (targets[j].first != tri[k])
+					++j;
+
+				--uses_[tri[k]];
+				tri[k] = targets[j].second;
+				++uses_[tri[k]];
+			}
+			triangles_[to].push_back(t);
+		}
+
+		quadric_[to] += quadric_[from];
+		collapsed_[from] = true;
+		++version_[from];
+		++version_[to];
+		std::vector<unsigned int>().swap(triangles);
+
+		// the edges around to change cost
+		std::vector<unsigned int>& around = triangles_[to];
+		around.erase(std::remove_if(around.begin(), around.end(),
+			[&](unsigned int t) { return !alive_[t]; }), around.end());
+
+		std::vector<unsigned int> neighbors;
+		for (size_t i = 0; i < around.size(); ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				const unsigned int c = class_of_[ib_[3 * around[i] + k]];
+				if (c != to)
+					neighbors.push_back(c);
+			}
+		}
+		std::sort(neighbors.begin(), neighbors.end());
+		neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+		for (size_t i = 0; i < neighbors.size(); ++i)
+			push_edge(to, neighbors[i]);
+	}
+
+	void Simplifier::simplify(size_t target, MeshLod& lod)
+	{
+		while (live_ > target && !queue_.empty())
+		{
+			const Collapse c = queue_.top();
+			queue_.pop();
+
+			if (collapsed_[c.from] || collapsed_[c.to] ||
+				version_[c.from] != c.from_version || version_[c.to] != c.to_version)
+				continue;
+
+			// queued again when a neighbor changes
+			if (flips(c.from, c.to))
+				continue;
+
+			collapse(c.from, c.to);
+			error_ = std::max(error_, std::sqrt(c.cost));
+		}
+
+		lod.ib.clear();
+		lod.ib.reserve(3 * live_);
+		for (size_t t = 0; t < alive_.size(); ++t)
+		{
+			if (alive_[t])
+				lod.ib.insert(lod.ib.end(), &ib_[3 * t], &ib_[3 * t] + 3);
+		}
+		lod.error = error_;
+	}
+
+}
+
+void MeshSimplifier::build_lods(Mesh& mesh, const std::vector<float>& ratios)
+{
+	mesh.lods.clear();
+	if (mesh.ib.empty())
+		return;
+
+	Simplifier simplifier(mesh);
+	const size_t triangles = mesh.ib.size() / 3;
+	for (size_t i = 0; i < ratios.size(); ++i)
+	{
+		MeshLod lod;
+		simplifier.simplify(static_cast<size_t>(ratios[i] * triangles), lod);
+		if (mesh.optimized)
+			MeshOptimizer::optimize_vertex_cache(lod.ib, mesh.vertex_count);
+		mesh.lods.push_back(lod);
+	}
+}
+
+void MeshSimplifier::build_lods(const std::vector<Mesh*>& meshes, const std::vector<float>& ratios,
+	unsigned int num_threads)
+{
+	if (num_threads == 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	num_threads = static_cast<unsigned int>(std::min<size_t>(num_threads, meshes.size()));
+
+	// each mesh is simplified by one thread from start to end
+	std::atomic<size_t> next(0);
+	const auto work = [&]() {
+		for (size_t i = next++; i < meshes.size(); i = next++)
+			build_lods(*meshes[i], ratios);
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < num_threads; ++i)
+		threads.push_back(std::thread(work));
+	work();
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+
+#include "Mesh.h"
+
+// Level of detail generation by quadric error metric simplification
+// (Garland and Heckbert). Edges are collapsed onto one of their ends, so the
+// levels are index buffers over the vertices of the mesh. Vertices at the
+// same position collapse together, each onto the vertex of the other end
+// with the closest normal and texcoord; that difference is weighed into the
+// error, so attribute seams and borders are kept until little else is left.
+//
+// Errors are the root mean square distance to the planes of the collapsed
+// faces plus the weighted attribute difference, relative to the largest
+// extent of the mesh: a level is fine to draw while error * extent projects
+// to less than a pixel or so.
+class MeshSimplifier
+{
+public:
+	// fills mesh.lods with one level per ratio of the triangles of mesh.ib
+	// (in decreasing order), each simplified further from the previous one.
+	// Levels of an optimized mesh are reordered for the vertex cache.
+	static void build_lods(Mesh& mesh, const std::vector<float>& ratios);
+
+	// build_lods for every mesh, num_threads meshes at a time (0: one per
+	// core); the result does not depend on num_threads
+	static void build_lods(const std::vector<Mesh*>& meshes, const std::vector<float>& ratios,
+		unsigned int num_threads = 0);
+};
@@ -0,0 +1,197 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "MeshBuilder.h"
+
+namespace {
+
+	// cones with normals this close to perpendicular to the axis cull nothing
+	const float kMinConeDot = 0.1f;
+
+	bool intersects(const MeshletBuilder::Frustum& frustum, const glm::vec3& center, float radius)
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			const glm::vec4& p = frustum.planes[i];
+			if (glm::dot(glm::vec3(p.x, p.y, p.z), center) + p.w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	// bounds of the triangles [first_index, first_index + index_count) of ib
+	void compute_bounds(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& ib,
+		const std::vector<unsigned int>& vertices, Meshlet& meshlet)
+	{
+		glm::vec3 lo = positions[vertices[0]], hi = lo;
+		for (size_t i = 1; i < vertices.size(); ++i)
+		{
+			lo = glm::min(lo, positions[vertices[i]]);
+			hi = glm::max(hi, positions[vertices[i]]);
+		}
+
+		meshlet.center = (lo + hi) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (size_t i = 0; i < vertices.size(); ++i)
+			meshlet.radius = std::max(meshlet.radius, glm::length(positions[vertices[i]] - meshlet.center));
+
+		std::vector<glm::vec3> normals;
+		glm::vec3 sum(0.0f);
+		for (unsigned int i = meshlet.first_index; i < meshlet.first_index + meshlet.index_count; i += 3)
+		{
+			const glm::vec3& a = positions[ib[i]];
+			const glm::vec3 n = glm::cross(positions[ib[i + 1]] - a, positions[ib[i + 2]] - a);
+			const float length = glm::length(n);
+			if (length > 0.0f)
+			{
+				normals.push_back(n / length);
+				sum += normals.back();
+			}
+		}
+
+		meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+		meshlet.cone_cutoff = 1.0f;
+
+		const float length = glm::length(sum);
+		if (length <= 0.0f)
+			return;
+
+		const glm::vec3 axis = sum / length;
+		float min_dot = 1.0f;
+		for (size_t i = 0; i < normals.size(); ++i)
+			min_dot = std::min(min_dot, glm::dot(normals[i], axis));
+
+		meshlet.cone_axis = axis;
+		if (min_dot >= kMinConeDot)
+			meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+	}
+
+}
+
+void MeshletBuilder::build(Mesh& mesh)
+{
+	mesh.meshlets.clear();
+
+	std::vector<glm::vec3> positions(mesh.vertex_count);
+	for (size_t i = 0; i < mesh.vertex_count; ++i)
+		positions[i] = MeshBuilder::position(mesh, i);
+
+	// owner[v]: 1 + the meshlet that v was last added to
+	std::vector<unsigned int> owner(mesh.vertex_count, 0);
+	std::vector<unsigned int> vertices;
+
+	const std::vector<unsigned int>& ib = mesh.ib;
+	Meshlet meshlet = Meshlet();
+	for (size_t i = 0; i + 2 < ib.size(); i += 3)
+	{
+		const unsigned int id = static_cast<unsigned int>(mesh.meshlets.size()) + 1;
+		const unsigned int added = (owner[ib[i]] != id) + (owner[ib[i + 1]] != id) + (owner[ib[i + 2]] != id);
+
+		if (meshlet.index_count / 3 + 1 > kMaxTriangles || vertices.size() + added > kMaxVertices)
+		{
+			meshlet.vertex_count = static_cast<unsigned int>(vertices.size());
+			compute_bounds(positions, ib, vertices, meshlet);
+			mesh.meshlets.push_back(meshlet);
+
+			meshlet = Meshlet();
+			meshlet.first_index = static_cast<unsigned int>(i);
+			vertices.clear();
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned int v = ib[i + k];
+			if (owner[v] != mesh.meshlets.size() + 1)
+			{
+				owner[v] = static_cast<unsigned int>(mesh.meshlets.size()) + 1;
+				vertices.push_back(v);
+			}
+		}
+		meshlet.index_count += 3;
+	}
+
+	if (meshlet.index_count > 0)
+	{
+		meshlet.vertex_count = static_cast<unsigned int>(vertices.size());
+		compute_bounds(positions, ib, vertices, meshlet);
+		mesh.meshlets.push_back(meshlet);
+	}
+}
+
+// Gribb and Hartmann: the planes are sums and differences of the rows
+MeshletBuilder::Frustum MeshletBuilder::frustum(const glm::mat4& pvm)
+{
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+		rows[i] = glm::vec4(pvm[0][i], pvm[1][i], pvm[2][i], pvm[3][i]);
+
+	Frustum frustum;
+	for (int i = 0; i < 3; ++i)
+	{
+		frustum.planes[2 * i] = rows[3] + rows[i];
+		frustum.planes[2 * i + 1] = rows[3] - rows[i];
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		glm::vec4& p = frustum.planes[i];
+		const float length = glm::length(glm::vec3(p.x, p.y, p.z));
+		if (length > 0.0f)
+			p = p * (1.0f / length);
+	}
+
+	return frustum;
+}
+
+bool MeshletBuilder::visible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& camera,
+	bool backface)
+{
+	if (!intersects(frustum, meshlet.center, meshlet.radius))
+		return false;
+
+	// every normal within the cone points away from every point of the
+	// sphere as seen from the camera
+	if (backface)
+	{
+		const glm::vec3 view = meshlet.center - camera;
+		if (glm::dot(view, meshlet.cone_axis) >= meshlet.cone_cutoff * glm::length(view) + meshlet.radius)
+			return false;
+	}
+
+	return true;
+}
+
+size_t MeshletBuilder::cull(const Mesh& mesh, const glm::mat4& pvm, const glm::vec3& camera,
+	bool backface, std::vector<unsigned int>& first_index, std::vector<unsigned int>& index_count)
+{
+	first_index.clear();
+	index_count.clear();
+
+	// nothing to test when the whole mesh is out of view
+	const Frustum planes = frustum(pvm);
+	if (mesh.sphere.radius >= 0.0f && !intersects(planes, mesh.sphere.center, mesh.sphere.radius))
+		return 0;
+
+	size_t count = 0;
+	for (size_t i = 0; i < mesh.meshlets.size(); ++i)
+	{
+		const Meshlet& meshlet = mesh.meshlets[i];
+		if (!visible(meshlet, planes, camera, backface))
+			continue;
+
+		++count;
+		if (!first_index.empty() && first_index.back() + index_count.back() == meshlet.first_index)
+		{
+			index_count.back() += meshlet.index_count;
+		}
+		else
+		{
+			first_index.push_back(meshlet.first_index);
+			index_count.push_back(meshlet.index_count);
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+// Splits a mesh into meshlets and culls them on the CPU. A meshlet is a run of
+// consecutive triangles of the index buffer, so the visible ones are drawn
+// straight from it with one glMultiDrawElements call. Runs follow the
+// triangle order, which MeshOptimizer has made local.
+class MeshletBuilder
+{
+public:
+	static const unsigned int kMaxVertices = 64;
+	static const unsigned int kMaxTriangles = 124;
+
+	// fills mesh.meshlets
+	static void build(Mesh& mesh);
+
+	// the planes (xyz . p + w >= 0 inside, xyz of unit length) of the view
+	// volume of a projection * view * model matrix, in model space
+	struct Frustum
+	{
+		glm::vec4	planes[6];
+	};
+
+	static Frustum frustum(const glm::mat4& pvm);
+
+	// false if the meshlet is outside the frustum or, with backface, faces
+	// away from camera (in model space) as a whole
+	static bool visible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& camera,
+		bool backface = true);
+
+	// the index ranges of the visible meshlets of mesh, adjacent ones merged;
+	// returns the number of visible meshlets
+	static size_t cull(const Mesh& mesh, const glm::mat4& pvm, const glm::vec3& camera,
+		bool backface, std::vector<unsigned int>& first_index, std::vector<unsigned int>& index_count);
+};
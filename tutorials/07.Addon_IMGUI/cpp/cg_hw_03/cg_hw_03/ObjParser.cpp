@@ -0,0 +1,531 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+const glm::vec3 ObjData::kDefaultColor(1.0f, 1.0f, 1.0f);
+
+void ObjData::clear()
+{
+	positions.clear();
+	colors.clear();
+	texcoords.clear();
+	normals.clear();
+	corners.clear();
+
+	first_position = first_texcoord = first_normal = 0;
+}
+
+namespace {
+
+	inline bool is_space(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline bool is_digit(char c)
+	{
+		return static_cast<unsigned char>(c - '0') < 10;
+	}
+
+	inline const char* skip_space(const char* p, const char* end)
+	{
+		while (p < end && is_space(*p))
+			++p;
+		return p;
+	}
+
+	// powers of ten that are exact in float and in double respectively
+	const float kPow10f[] = {
+		1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+	};
+	const double kPow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	// strtof on a copy of the token starting at p (the mapped range is not
+	// NUL-terminated); used for the rare inputs the fast paths cannot round
+	// exactly, and for inf/nan
+	const char* parse_float_slow(const char* p, const char* end, float& value)
+	{
+		const char* q = p;
+		while (q < end && !is_space(*q) && *q != '\n' && *q != '/')
+			++q;
+
+		char buf[64];
+		std::string long_token;
+		const char* token = buf;
+		const size_t n = q - p;
+		if (n < sizeof(buf))
+		{
+			std::memcpy(buf, p, n);
+			buf[n] = '\0';
+		}
+		else
+		{
+			long_token.assign(p, q);
+			token = long_token.c_str();
+		}
+
+		char* stop;
+		value = std::strtof(token, &stop);
+		return (stop == token) ? 0 : p + (stop - token);
+	}
+
+}
+
+// Clinger's fast path: when the decimal mantissa and the power of ten are
+// both exact in the floating-point type, one multiplication or division
+// rounds correctly. Float covers the usual OBJ precision (up to 7 significant
+// digits); otherwise double is used, checking for the rare double-rounding
+// tie on the way down to float.
+const char* ObjParser::parse_float(const char* p, const char* end, float& value)
+{
+	const char* start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;					// significant digits kept in mantissa
+	int exponent = 0;
+	bool truncated = false;
+	bool any_digit = false;
+
+	for (; p < end && is_digit(*p); ++p)
+	{
+		any_digit = true;
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0)
+				++digits;
+		}
+		else
+		{
+			++exponent;
+			truncated = truncated || *p != '0';
+		}
+	}
+
+	if (p < end && *p == '.')
+	{
+		for (++p; p < end && is_digit(*p); ++p)
+		{
+			any_digit = true;
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0)
+					++digits;
+				--exponent;
+			}
+			else
+			{
+				truncated = truncated || *p != '0';
+			}
+		}
+	}
+
+	if (!any_digit)
+		return parse_float_slow(start, end, value);
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+		bool exp_negative = false;
+		if (q < end && (*q == '-' || *q == '+'))
+		{
+			exp_negative = (*q == '-');
+			++q;
+		}
+
+		if (q < end && is_digit(*q))
+		{
+			int e = 0;
+			for (; q < end && is_digit(*q); ++q)
+			{
+				if (e < 100000)
+					e = e * 10 + (*q - '0');
+			}
+			exponent += exp_negative ? -e : e;
+			p = q;
+		}
+	}
+
+	if (mantissa == 0)
+	{
+		value = negative ? -0.0f : 0.0f;
+		return p;
+	}
+
+	if (!truncated)
+	{
+		if (mantissa <= (1u << 24) && exponent >= -10 && exponent <= 10)
+		{
+			float f = static_cast<float>(mantissa);
+			f = (exponent < 0) ? f / kPow10f[-exponent] : f * kPow10f[exponent];
+			value = negative ? -f : f;
+			return p;
+		}
+
+		if (mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+		{
+			double d = static_cast<double>(mantissa);
+			d = (exponent < 0) ? d / kPow10[-exponent] : d * kPow10[exponent];
+
+			// d is correctly rounded; rounding it again to float is exact
+			// unless d landed exactly halfway between two floats
+			uint64_t bits;
+			std::memcpy(&bits, &d, sizeof(bits));
+			const bool normal_float = d >= 1.17549435e-38 && d <= 3.40282346e38;
+			if (normal_float && (bits & 0x1FFFFFFF) != 0x10000000)
+			{
+				const float f = static_cast<float>(d);
+				value = negative ? -f : f;
+				return p;
+			}
+		}
+	}
+
+	return parse_float_slow(start, end, value);
+}
+
+const char* ObjParser::parse_int(const char* p, const char* end, int& value)
+{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	if (p >= end || !is_digit(*p))
+		return 0;
+
+	int n = 0;
+	for (; p < end && is_digit(*p); ++p)
+	{
+		const int digit = *p - '0';
+		if (n > (INT_MAX - digit) / 10)
+			return 0;
+		n = n * 10 + digit;
+	}
+
+	value = negative ? -n : n;
+	return p;
+}
+
+namespace {
+
+	// relative (negative) index -> absolute, counting the records seen so far
+	inline int resolve(int index, size_t count)
+	{
+		return (index < 0) ? static_cast<int>(count) + 1 + index : index;
+	}
+
+	// v[/[vt][/vn]]; absent indices are 0
+	const char* parse_corner(const char* p, const char* end, ObjIndex& c)
+	{
+		c.vt = c.vn = 0;
+
+		p = ObjParser::parse_int(p, end, c.v);
+		if (!p || p == end || *p != '/')
+			return p;
+
+		++p;
+		if (p < end && *p != '/')
+		{
+			p = ObjParser::parse_int(p, end, c.vt);
+			if (!p || p == end || *p != '/')
+				return p;
+		}
+
+		return ObjParser::parse_int(p + 1, end, c.vn);
+	}
+
+	// appends a corner with its relative indices made absolute
+	void push_corner(ObjIndex c, ObjData& data, std::vector<size_t>* fixups)
+	{
+		const size_t corner = data.corners.size();
+		if (fixups && c.v < 0)
+			fixups->push_back(3 * corner);
+		if (fixups && c.vt < 0)
+			fixups->push_back(3 * corner + 1);
+		if (fixups && c.vn < 0)
+			fixups->push_back(3 * corner + 2);
+
+		c.v = resolve(c.v, data.first_position + data.positions.size());
+		c.vt = resolve(c.vt, data.first_texcoord + data.texcoords.size());
+		c.vn = resolve(c.vn, data.first_normal + data.normals.size());
+		data.corners.push_back(c);
+	}
+
+	// the parse loop; when fixups is given, every corner index that was
+	// relative is recorded as 3 * corner + (0: v, 1: vt, 2: vn), since it was
+	// resolved against the records of this chunk only
+	const char* parse_records(const char* begin, const char* end, ObjData& data,
+		std::vector<size_t>* fixups)
+	{
+		const char* line = begin;
+
+		while (line < end)
+		{
+			const char* eol = static_cast<const char*>(std::memchr(line, '\n', end - line));
+			if (!eol)
+				eol = end;
+
+			const char* p = skip_space(line, eol);
+
+			// blank lines, comments and unsupported records (o, g, s, usemtl...)
+			// fall through without any work
+			if (p + 1 < eol && is_space(p[1]))
+			{
+				if (p[0] == 'v')
+				{
+					glm::vec3 position;
+					for (int i = 0; i < 3; ++i)
+					{
+						p = ObjParser::parse_float(skip_space(p + (i == 0 ? 1 : 0), eol), eol, position[i]);
+						if (!p)
+							return line;
+					}
+
+					// optional "r g b" after the position; anything else (such
+					// as a single w) is ignored
+					glm::vec3 color;
+					int num_colors = 0;
+					for (const char* q = skip_space(p, eol); num_colors < 3 && q < eol; q = skip_space(q, eol))
+					{
+						q = ObjParser::parse_float(q, eol, color[num_colors]);
+						if (!q)
+							break;
+						++num_colors;
+					}
+
+					if (num_colors == 3)
+					{
+						data.colors.resize(data.positions.size(), ObjData::kDefaultColor);
+						data.colors.push_back(color);
+					}
+					else if (!data.colors.empty())
+					{
+						data.colors.push_back(ObjData::kDefaultColor);
+					}
+					data.positions.push_back(position);
+				}
+				else if (p[0] == 'f')
+				{
+					// v, v/vt, v//vn or v/vt/vn corners; polygons are split into
+					// a fan around the first corner
+					ObjIndex first, previous;
+					int count = 0;
+					for (p = skip_space(p + 1, eol); p < eol; p = skip_space(p, eol))
+					{
+						ObjIndex c;
+						p = parse_corner(p, eol, c);
+						if (!p || (p < eol && !is_space(*p)))
+							return line;
+
+						if (count >= 2)
+						{
+							push_corner(first, data, fixups);
+							push_corner(previous, data, fixups);
+							push_corner(c, data, fixups);
+						}
+						else if (count == 0)
+						{
+							first = c;
+						}
+						previous = c;
+						++count;
+					}
+
+					if (count < 3)
+						return line;
+				}
+			}
+			else if (p + 2 < eol && p[0] == 'v' && is_space(p[2]))
+			{
+				if (p[1] == 't')
+				{
+					glm::vec2 texcoord;
+					for (int i = 0; i < 2; ++i)
+					{
+						p = ObjParser::parse_float(skip_space(p + (i == 0 ? 2 : 0), eol), eol, texcoord[i]);
+						if (!p)
+							return line;
+					}
+					data.texcoords.push_back(texcoord);
+				}
+				else if (p[1] == 'n')
+				{
+					glm::vec3 normal;
+					for (int i = 0; i < 3; ++i)
+					{
+						p = ObjParser::parse_float(skip_space(p + (i == 0 ? 2 : 0), eol), eol, normal[i]);
+						if (!p)
+							return line;
+					}
+					data.normals.push_back(normal);
+				}
+			}
+
+			line = (eol < end) ? eol + 1 : end;
+		}
+
+		return 0;
+	}
+
+	struct Chunk
+	{
+		const char*					begin;
+		const char*					end;
+		ObjData							data;
+		std::vector<size_t>	fixups;
+		const char*					bad_line;
+
+		// record counts of all chunks before this one
+		size_t							positions, texcoords, normals, corners;
+	};
+
+	void parse_chunk(Chunk* chunk)
+	{
+		chunk->bad_line = parse_records(chunk->begin, chunk->end, chunk->data, &chunk->fixups);
+	}
+
+	// copies the chunk to its place in the output and turns the indices that
+	// were relative to the chunk into global ones
+	void stitch_chunk(Chunk* chunk, ObjData* data)
+	{
+		const ObjData& src = chunk->data;
+
+		std::copy(src.positions.begin(), src.positions.end(), data->positions.begin() + chunk->positions);
+		if (!src.colors.empty())
+			std::copy(src.colors.begin(), src.colors.end(), data->colors.begin() + chunk->positions);
+		std::copy(src.texcoords.begin(), src.texcoords.end(), data->texcoords.begin() + chunk->texcoords);
+		std::copy(src.normals.begin(), src.normals.end(), data->normals.begin() + chunk->normals);
+
+		ObjIndex* corners = data->corners.data() + chunk->corners;
+		std::copy(src.corners.begin(), src.corners.end(), corners);
+
+		for (size_t i = 0; i < chunk->fixups.size(); ++i)
+		{
+			ObjIndex& c = corners[chunk->fixups[i] / 3];
+			switch (chunk->fixups[i] % 3)
+			{
+			case 0: c.v += static_cast<int>(chunk->positions); break;
+			case 1: c.vt += static_cast<int>(chunk->texcoords); break;
+			case 2: c.vn += static_cast<int>(chunk->normals); break;
+			}
+		}
+	}
+
+}
+
+const char* ObjParser::parse(const char* begin, const char* end, ObjData& data)
+{
+	return parse_records(begin, end, data, 0);
+}
+
+// The range is cut into one chunk per thread at line boundaries and each
+// chunk is parsed into its own arrays. Positive indices are already global;
+// relative ones only know the records of their chunk, so after an exclusive
+// prefix sum over the chunk record counts the chunks are copied into place in
+// parallel and those indices are offset by the counts that precede them.
+const char* ObjParser::parse_parallel(const char* begin, const char* end, ObjData& data,
+	unsigned int num_threads)
+{
+	if (num_threads == 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	const size_t size = end - begin;
+	const size_t max_chunks = std::max<size_t>(1, size / kMinChunkSize);
+	const size_t num_chunks = std::min<size_t>(num_threads, max_chunks);
+	if (num_chunks == 1)
+		return parse(begin, end, data);
+
+	std::vector<Chunk> chunks(num_chunks);
+	const char* chunk_begin = begin;
+	for (size_t i = 0; i < num_chunks; ++i)
+	{
+		const char* chunk_end = end;
+		if (i + 1 < num_chunks)
+		{
+			chunk_end = std::max(chunk_begin, begin + size / num_chunks * (i + 1));
+			const char* eol = static_cast<const char*>(std::memchr(chunk_end, '\n', end - chunk_end));
+			chunk_end = eol ? eol + 1 : end;
+		}
+
+		chunks[i].begin = chunk_begin;
+		chunks[i].end = chunk_end;
+		chunks[i].data.first_position = data.first_position;
+		chunks[i].data.first_texcoord = data.first_texcoord;
+		chunks[i].data.first_normal = data.first_normal;
+		chunk_begin = chunk_end;
+	}
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < num_chunks; ++i)
+		threads.push_back(std::thread(parse_chunk, &chunks[i]));
+	parse_chunk(&chunks[0]);
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+	threads.clear();
+
+	for (size_t i = 0; i < num_chunks; ++i)
+	{
+		if (chunks[i].bad_line)
+			return chunks[i].bad_line;
+	}
+
+	// exclusive prefix sum of the record counts, starting after what data
+	// already holds
+	size_t positions = data.positions.size();
+	size_t texcoords = data.texcoords.size();
+	size_t normals = data.normals.size();
+	size_t corners = data.corners.size();
+	for (size_t i = 0; i < num_chunks; ++i)
+	{
+		Chunk& chunk = chunks[i];
+		chunk.positions = positions;
+		chunk.texcoords = texcoords;
+		chunk.normals = normals;
+		chunk.corners = corners;
+
+		positions += chunk.data.positions.size();
+		texcoords += chunk.data.texcoords.size();
+		normals += chunk.data.normals.size();
+		corners += chunk.data.corners.size();
+	}
+
+	// colors are kept for every position as soon as one has them
+	bool colors = !data.colors.empty();
+	for (size_t i = 0; i < num_chunks; ++i)
+		colors = colors || !chunks[i].data.colors.empty();
+
+	data.positions.resize(positions);
+	if (colors)
+		data.colors.resize(positions, ObjData::kDefaultColor);
+	data.texcoords.resize(texcoords);
+	data.normals.resize(normals);
+	data.corners.resize(corners);
+
+	for (size_t i = 1; i < num_chunks; ++i)
+		threads.push_back(std::thread(stitch_chunk, &chunks[i], &data));
+	stitch_chunk(&chunks[0], &data);
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// one face corner as written in the file: 1-based indices, 0 if absent
+struct ObjIndex
+{
+	int v, vt, vn;
+};
+
+// records of an OBJ file in file order
+struct ObjData
+{
+	std::vector<glm::vec3>	positions;	// v
+	std::vector<glm::vec3>	colors;			// v x y z r g b; empty or one per position
+	std::vector<glm::vec2>	texcoords;	// vt
+	std::vector<glm::vec3>	normals;		// vn
+	std::vector<ObjIndex>		corners;		// f, three corners per triangle
+
+	// records of the file that precede these ones when only a part of it is
+	// parsed; relative indices count them too
+	size_t									first_position, first_texcoord, first_normal;
+
+	ObjData() : first_position(0), first_texcoord(0), first_normal(0) {}
+
+	void clear();
+
+	static const glm::vec3 kDefaultColor;		// of positions written without one
+};
+
+// Zero-copy OBJ tokenizer working directly on a (memory-mapped) character
+// range. Lines are located with memchr and numbers are parsed in place, so
+// nothing is allocated per line; only the output arrays grow.
+class ObjParser
+{
+public:
+	// appends the records in [begin, end) to data, with relative (negative)
+	// face indices made absolute and polygons split into triangle fans;
+	// returns 0 on success or the start of the first malformed line
+	static const char* parse(const char* begin, const char* end, ObjData& data);
+
+	// same as parse, with the range split at line boundaries across
+	// num_threads threads (0: one per core); the result is identical to the
+	// serial one. Ranges shorter than kMinChunkSize per thread use fewer threads.
+	static const char* parse_parallel(const char* begin, const char* end, ObjData& data,
+		unsigned int num_threads = 0);
+
+	static const size_t kMinChunkSize = 1 << 20;
+
+	// number parsers: return the position after the number, or 0 if there is
+	// no number at p. parse_float gives the same result as strtof.
+	static const char* parse_float(const char* p, const char* end, float& value);
+	static const char* parse_int(const char* p, const char* end, int& value);
+};
@@ -0,0 +1,495 @@
+#include "ObjStream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "ObjParser.h"
+
+namespace {
+
+	// reads a file in windows of at most window_size bytes that end at line
+	// boundaries; the partial last line is carried over to the next window
+	class WindowReader
+	{
+	public:
+		WindowReader() : size_(0), window_(0), line_(0), error_(0) {}
+
+		bool open(const std::string& filename, size_t window_size)
+		{
+			file_.open(filename.c_str(), std::ios::binary);
+			buffer_.resize(window_size);
+			return file_.is_open();
+		}
+
+		// the next window, or false at the end of the file or on error()
+		bool next(const char*& begin, const char*& end)
+		{
+			line_ += std::count(buffer_.data(), buffer_.data() + window_, '\n');
+			std::memmove(buffer_.data(), buffer_.data() + window_, size_ - window_);
+			size_ -= window_;
+			window_ = 0;
+
+			if (file_.is_open())
+			{
+				file_.read(buffer_.data() + size_, buffer_.size() - size_);
+				size_ += file_.gcount();
+				if (file_.bad())
+				{
+					error_ = "failed to read file";
+					return false;
+				}
+				if (file_.eof())
+					file_.close();
+			}
+
+			if (size_ == 0)
+				return false;
+
+			window_ = size_;
+			if (file_.is_open())
+			{
+				while (window_ > 0 && buffer_[window_ - 1] != '\n')
+					--window_;
+				if (window_ == 0)
+				{
+					error_ = "line longer than the stream window in file";
+					return false;
+				}
+			}
+
+			begin = buffer_.data();
+			end = begin + window_;
+			return true;
+		}
+
+		// 1-based number of the line at p in the current window
+		size_t line(const char* p) const
+		{
+			return line_ + std::count(buffer_.data(), p, '\n') + 1;
+		}
+
+		const char* error() const { return error_; }
+
+	private:
+		std::ifstream			file_;		// closed once read to the end
+		std::vector<char>	buffer_;
+		size_t						size_;		// bytes in buffer_
+		size_t						window_;	// bytes of the current window
+		size_t						line_;		// lines before the current window
+		const char*				error_;
+	};
+
+	// vertex records of one kind: the last ones read, or all of them once the
+	// side file is mapped
+	template <typename T>
+	class RecordCache
+	{
+	public:
+		explicit RecordCache(size_t capacity) : ring_(capacity), count_(0), records_(0), size_(0) {}
+
+		size_t count() const { return count_; }
+
+		void push(const std::vector<T>& records)
+		{
+			// only the last ring_.size() records can be kept
+			size_t i = records_ ? records.size() : records.size() - std::min(records.size(), ring_.size());
+			count_ += i;
+
+			for (; i < records.size(); ++i)
+				ring_[count_++ % ring_.size()] = records[i];
+		}
+
+		void map(const MappedFile& file)
+		{
+			records_ = reinterpret_cast<const T*>(file.begin());
+			size_ = file.size() / sizeof(T);
+			std::vector<T>().swap(ring_);
+		}
+
+		// 1-based index, 0 for none; false if the record is not at hand
+		bool get(int index, T& value) const
+		{
+			if (index == 0)
+			{
+				value = T(0.0f);
+				return true;
+			}
+
+			const size_t i = index - 1;
+			if (records_)
+			{
+				if (i >= size_)
+					return false;
+				value = records_[i];
+				return true;
+			}
+
+			if (i >= count_ || count_ - i > ring_.size())
+				return false;
+			value = ring_[i % ring_.size()];
+			return true;
+		}
+
+	private:
+		std::vector<T>	ring_;
+		size_t					count_;			// records pushed so far
+		const T*				records_;		// of the mapped side file
+		size_t					size_;
+	};
+
+	struct Vertex
+	{
+		glm::vec3	position;
+		glm::vec2	texcoord;
+		glm::vec3	normal;
+	};
+
+	// every v, vt and vn record of the file, written out by the first pass of
+	// the fallback and removed again when the stream ends
+	class SideFiles
+	{
+	public:
+		explicit SideFiles(const std::string& filename)
+		{
+			static const char* const kSuffixes[3] = { ".stream.v", ".stream.vt", ".stream.vn" };
+			for (int i = 0; i < 3; ++i)
+				names_[i] = filename + kSuffixes[i];
+		}
+
+		~SideFiles()
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				if (files_[i].is_open())
+				{
+					files_[i].close();
+					std::remove(names_[i].c_str());
+				}
+			}
+		}
+
+		const MappedFile& positions() const		{ return files_[0]; }
+		const MappedFile& texcoords() const		{ return files_[1]; }
+		const MappedFile& normals() const			{ return files_[2]; }
+
+		// writes the side files and maps them
+		bool create(const std::string& filename, size_t window_size)
+		{
+			const bool written = write_all(filename, window_size);
+			for (int i = 0; i < 3; ++i)
+			{
+				if (!written || !files_[i].open(names_[i]))
+				{
+					for (int j = 0; j < 3; ++j)
+					{
+						files_[j].close();
+						std::remove(names_[j].c_str());
+					}
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+	private:
+		template <typename T>
+		static void write(std::ofstream& file, const std::vector<T>& records)
+		{
+			file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+		}
+
+		bool write_all(const std::string& filename, size_t window_size) const
+		{
+			WindowReader reader;
+			if (!reader.open(filename, window_size))
+			{
+				std::cerr << "failed to open file: " << filename << std::endl;
+				return false;
+			}
+
+			std::ofstream files[3];
+			for (int i = 0; i < 3; ++i)
+				files[i].open(names_[i].c_str(), std::ios::binary | std::ios::trunc);
+
+			ObjData data;
+			const char* begin;
+			const char* end;
+			while (files[0] && files[1] && files[2] && reader.next(begin, end))
+			{
+				data.clear();
+				const char* bad_line = ObjParser::parse(begin, end, data);
+				if (bad_line)
+				{
+					std::cerr << "failed to parse file: " << filename << " (line "
+						<< reader.line(bad_line) << ")" << std::endl;
+					return false;
+				}
+
+				write(files[0], data.positions);
+				write(files[1], data.texcoords);
+				write(files[2], data.normals);
+			}
+
+			if (reader.error())
+			{
+				std::cerr << reader.error() << ": " << filename << std::endl;
+				return false;
+			}
+
+			for (int i = 0; i < 3; ++i)
+				files[i].close();
+			if (!files[0] || !files[1] || !files[2])
+			{
+				std::cerr << "failed to write stream side files: " << filename << std::endl;
+				return false;
+			}
+
+			return true;
+		}
+
+		std::string	names_[3];
+		MappedFile	files_[3];
+	};
+
+	// the vertex caches of all three record kinds
+	class VertexCache
+	{
+	public:
+		explicit VertexCache(size_t capacity)
+			: positions_(capacity), texcoords_(capacity), normals_(capacity), mapped_(false)
+		{}
+
+		bool is_mapped() const { return mapped_; }
+
+		// so that relative indices of the next window resolve against the file
+		void set_first(ObjData& data) const
+		{
+			data.first_position = positions_.count();
+			data.first_texcoord = texcoords_.count();
+			data.first_normal = normals_.count();
+		}
+
+		void push(const ObjData& data)
+		{
+			positions_.push(data.positions);
+			texcoords_.push(data.texcoords);
+			normals_.push(data.normals);
+		}
+
+		void map(const SideFiles& files)
+		{
+			positions_.map(files.positions());
+			texcoords_.map(files.texcoords());
+			normals_.map(files.normals());
+			mapped_ = true;
+		}
+
+		bool get(const ObjIndex& corner, Vertex& vertex) const
+		{
+			return positions_.get(corner.v, vertex.position) &&
+				texcoords_.get(corner.vt, vertex.texcoord) &&
+				normals_.get(corner.vn, vertex.normal);
+		}
+
+	private:
+		RecordCache<glm::vec3>	positions_;
+		RecordCache<glm::vec2>	texcoords_;
+		RecordCache<glm::vec3>	normals_;
+		bool										mapped_;
+	};
+
+	// collects triangles into a chunk, merging corners with the same indices,
+	// and hands the chunk over when the next triangle would not fit
+	class ChunkBuilder
+	{
+	public:
+		ChunkBuilder(const ObjStream::Options& options, const ObjStream::Callback& callback)
+			: options_(options), callback_(callback), stamp_(1), triangles_(0), chunks_(0)
+		{
+			std::memset(slots_, 0, sizeof(slots_));
+			chunk_.first_triangle = 0;
+		}
+
+		size_t chunks() const { return chunks_; }
+
+		void add(const ObjIndex* corners, const Vertex* vertices)
+		{
+			int missing = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				if (slots_[find(corners[k])].stamp != stamp_)
+					++missing;
+			}
+
+			if (chunk_.indices.size() / 3 + 1 > options_.max_triangles ||
+				chunk_.positions.size() + missing > options_.max_vertices)
+				flush();
+
+			for (int k = 0; k < 3; ++k)
+			{
+				Slot& slot = slots_[find(corners[k])];
+				if (slot.stamp != stamp_)
+				{
+					slot.corner = corners[k];
+					slot.stamp = stamp_;
+					slot.local = static_cast<unsigned char>(chunk_.positions.size());
+					chunk_.positions.push_back(vertices[k].position);
+					chunk_.texcoords.push_back(vertices[k].texcoord);
+					chunk_.normals.push_back(vertices[k].normal);
+				}
+				chunk_.indices.push_back(slot.local);
+			}
+			++triangles_;
+		}
+
+		void flush()
+		{
+			if (!chunk_.indices.empty())
+			{
+				callback_(chunk_);
+				++chunks_;
+			}
+
+			chunk_.positions.clear();
+			chunk_.texcoords.clear();
+			chunk_.normals.clear();
+			chunk_.indices.clear();
+			chunk_.first_triangle = triangles_;
+			++stamp_;
+		}
+
+	private:
+		// twice the largest chunk, so probes stay short
+		static const size_t kNumSlots = 512;
+
+		struct Slot
+		{
+			ObjIndex			corner;
+			unsigned int	stamp;			// slots of earlier chunks are free
+			unsigned char	local;
+		};
+
+		// the slot of corner, or the free slot where it goes
+		size_t find(const ObjIndex& corner) const
+		{
+			size_t i = (static_cast<unsigned int>(corner.v) * 73856093u ^
+				static_cast<unsigned int>(corner.vt) * 19349663u ^
+				static_cast<unsigned int>(corner.vn) * 83492791u) & (kNumSlots - 1);
+
+			while (slots_[i].stamp == stamp_ &&
+				(slots_[i].corner.v != corner.v || slots_[i].corner.vt != corner.vt ||
+				slots_[i].corner.vn != corner.vn))
+				i = (i + 1) & (kNumSlots - 1);
+			return i;
+		}
+
+		const ObjStream::Options&		options_;
+		const ObjStream::Callback&	callback_;
+		ObjChunk										chunk_;
+		Slot												slots_[kNumSlots];
+		unsigned int								stamp_;
+		size_t											triangles_;		// added so far
+		size_t											chunks_;			// handed over so far
+	};
+
+}
+
+bool ObjStream::load(const std::string& filename, const Callback& callback, const Options& options)
+{
+	if (options.window_size == 0 || options.max_vertices < 3 || options.max_vertices > 256 ||
+		options.max_triangles == 0)
+	{
+		std::cerr << "invalid stream options for file: " << filename << std::endl;
+		return false;
+	}
+
+	WindowReader reader;
+	if (!reader.open(filename, options.window_size))
+	{
+		std::cerr << "failed to open file: " << filename << std::endl;
+		return false;
+	}
+
+	VertexCache cache(options.cache_size);
+	SideFiles side_files(filename);
+	ChunkBuilder builder(options, callback);
+
+	ObjData data;
+	const char* begin;
+	const char* end;
+	while (reader.next(begin, end))
+	{
+		data.clear();
+		cache.set_first(data);
+
+		const char* bad_line = ObjParser::parse(begin, end, data);
+		if (bad_line)
+		{
+			std::cerr << "failed to parse file: " << filename << " (line "
+				<< reader.line(bad_line) << ")" << std::endl;
+			return false;
+		}
+
+		cache.push(data);
+
+		for (size_t i = 0; i + 2 < data.corners.size(); i += 3)
+		{
+			const ObjIndex* corners = &data.corners[i];
+
+			Vertex vertices[3];
+			bool found = true;
+			for (int k = 0; k < 3; ++k)
+			{
+				const ObjIndex& c = corners[k];
+				if (c.v < 1 || c.vt < 0 || c.vn < 0)
+				{
+					std::cerr << "invalid index " << c.v << "/" << c.vt << "/" << c.vn
+						<< " in file: " << filename << std::endl;
+					return false;
+				}
+				found = found && cache.get(c, vertices[k]);
+			}
+
+			if (!found && !cache.is_mapped())
+			{
+				// out of the cache: take the second pass from here on
+				if (!side_files.create(filename, options.window_size))
+					return false;
+				cache.map(side_files);
+
+				found = true;
+				for (int k = 0; k < 3; ++k)
+					found = found && cache.get(corners[k], vertices[k]);
+			}
+
+			if (!found)
+			{
+				int k = 0;
+				while (cache.get(corners[k], vertices[k]))
+					++k;
+				std::cerr << "invalid index " << corners[k].v << "/" << corners[k].vt << "/"
+					<< corners[k].vn << " in file: " << filename << std::endl;
+				return false;
+			}
+
+			builder.add(corners, vertices);
+		}
+	}
+
+	if (reader.error())
+	{
+		std::cerr << reader.error() << ": " << filename << std::endl;
+		return false;
+	}
+
+	builder.flush();
+
+	std::cout << "finished to stream: " << filename << " (" << builder.chunks() << " chunks"
+		<< (cache.is_mapped() ? ", two passes" : "") << ")" << std::endl;
+	return true;
+}
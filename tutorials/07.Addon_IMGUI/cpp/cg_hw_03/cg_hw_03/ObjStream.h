@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// a meshlet of a streamed OBJ file: triangles over a small local vertex set
+struct ObjChunk
+{
+	std::vector<glm::vec3>			positions;
+	std::vector<glm::vec2>			texcoords;			// one per vertex, zero where the face gives none
+	std::vector<glm::vec3>			normals;				// one per vertex, zero where the face gives none
+	std::vector<unsigned char>	indices;				// into the vertices, three per triangle
+	size_t											first_triangle;	// of the file, counting in file order
+};
+
+// Streaming OBJ loader for files larger than memory. The file is read in
+// fixed-size windows and its triangles are handed to the callback in chunks
+// as soon as their faces are parsed, so only one window, the vertex cache and
+// one chunk are held at a time.
+//
+// Vertices are looked up in a ring cache of the last cache_size records of
+// each kind. The first face that refers outside of it (to a vertex written
+// long before, or after the face) switches to a two-pass fallback: every
+// vertex record of the file is written once to side files next to it, which
+// are then memory-mapped and indexed directly until the end of the stream.
+// Vertex colors are not streamed.
+class ObjStream
+{
+public:
+	typedef std::function<void(const ObjChunk&)> Callback;
+
+	struct Options
+	{
+		size_t				window_size;		// bytes read at a time; no line may be longer
+		size_t				cache_size;			// records of each kind kept; 0 always takes two passes
+		unsigned int	max_vertices;		// per chunk, at most 256
+		unsigned int	max_triangles;	// per chunk
+
+		Options()
+			: window_size(16 << 20), cache_size(1 << 22), max_vertices(64), max_triangles(124)
+		{}
+	};
+
+	static bool load(const std::string& filename, const Callback& callback,
+		const Options& options = Options());
+};
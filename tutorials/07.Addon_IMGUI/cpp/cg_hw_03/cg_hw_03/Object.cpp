@@ -1,107 +1,258 @@
 #include <GL/glew.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include <locale>
 
 #include "Object.h"
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
 
-void Object::draw(int loc_a_vertex)
+namespace {
+
+	// how each VertexFormat attribute is fed to glVertexAttribPointer
+	struct AttribPointer
+	{
+		GLint			components;
+		GLenum		type;
+		GLboolean	normalized;
+	};
+
+	AttribPointer attrib_pointer(const VertexFormat& format, VertexFormat::Attribute attribute)
+	{
+		const bool quantized = (format.encoding != VertexFormat::FLOAT);
+		const AttribPointer pointers[] = {
+			{ 3, GLenum(quantized ? GL_UNSIGNED_SHORT : GL_FLOAT), GLboolean(quantized) },	// POSITION
+			{ quantized ? 2 : 3, GLenum(format.encoding == VertexFormat::QUANTIZED_OCT8 ? GL_BYTE :
+				quantized ? GL_SHORT : GL_FLOAT), GLboolean(quantized) },											// NORMAL
+			{ 2, GLenum(quantized ? GL_HALF_FLOAT : GL_FLOAT), GL_FALSE },									// TEXCOORD
+			{ 4, GLenum(quantized ? GL_BYTE : GL_FLOAT), GLboolean(quantized) },						// TANGENT
+			{ 4, GL_UNSIGNED_BYTE, GL_TRUE }																								// COLOR
+		};
+
+		int i = 0;
+		while (VertexFormat::attribute(i) != attribute)
+			++i;
+		return pointers[i];
+	}
+
+}
+
+void Object::draw(int loc_a_vertex, int loc_a_normal, int loc_a_texcoord,
+	int loc_a_tangent, int loc_a_color)
 {
-	glVertexAttribPointer(loc_a_vertex, 3, GL_FLOAT, false, 0, &vb[0]);
+	if (mesh_.ib.empty())
+		return;
+	if (!vbo_)
+		upload();
+
+	const int locations[VertexFormat::kNumAttributes] = {
+		loc_a_vertex, loc_a_normal, loc_a_texcoord, loc_a_tangent, loc_a_color
+	};
+	const VertexFormat& format = mesh_.format;
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+	for (int i = 0; i < VertexFormat::kNumAttributes; ++i)
+	{
+		const VertexFormat::Attribute attribute = VertexFormat::attribute(i);
+		if (locations[i] < 0 || !format.has(attribute))
+			continue;
+
+		const AttribPointer pointer = attrib_pointer(format, attribute);
+		glVertexAttribPointer(locations[i], pointer.components, pointer.type, pointer.normalized,
+			format.step(attribute),
+			reinterpret_cast<const void*>(format.offset(attribute, mesh_.vertex_count)));
 	
-	glEnableVertexAttribArray(loc_a_vertex);
+		glEnableVertexAttribArray(locations[i]);
+	}
 	
-	glDrawArrays(GL_TRIANGLES, 0, vb.size());
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+	if (culled_)
+	{
+		const size_t index_size = (index_type_ == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+		std::vector<GLsizei> counts(draw_count_.begin(), draw_count_.end());
+		std::vector<const void*> offsets(draw_first_.size());
+		for (size_t i = 0; i < offsets.size(); ++i)
+			offsets[i] = reinterpret_cast<const void*>(draw_first_[i] * index_size);
+
+		glMultiDrawElements(GL_TRIANGLES, counts.data(), index_type_, offsets.data(), static_cast<GLsizei>(counts.size()));
+	}
+	else
+	{
+		glDrawElements(GL_TRIANGLES, mesh_.ib.size(), index_type_, 0);
+	}
+
+	for (int i = 0; i < VertexFormat::kNumAttributes; ++i)
+	{
+		if (locations[i] >= 0 && format.has(VertexFormat::attribute(i)))
+			glDisableVertexAttribArray(locations[i]);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Object::upload()
+{
+	if (!vbo_)
+		glGenBuffers(1, &vbo_);
+	if (!ibo_)
+		glGenBuffers(1, &ibo_);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+	glBufferData(GL_ARRAY_BUFFER, mesh_.vb.size(), mesh_.vb.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glDisableVertexAttribArray(loc_a_vertex);	
+	// 16-bit indices halve the index upload whenever they can address the mesh
+	const std::vector<unsigned int>& ib = mesh_.ib;
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+	if (mesh_.vertex_count <= 0x10000)
+	{
+		std::vector<GLushort> ib16(ib.begin(), ib.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, ib16.size() * sizeof(GLushort), ib16.data(), GL_STATIC_DRAW);
+		index_type_ = GL_UNSIGNED_SHORT;
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, ib.size() * sizeof(GLuint), ib.data(), GL_STATIC_DRAW);
+		index_type_ = GL_UNSIGNED_INT;
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Object::cull(const glm::mat4& pvm, const glm::vec3& camera, bool backface)
+{
+	MeshletBuilder::cull(mesh_, pvm, camera, backface, draw_first_, draw_count_);
+	culled_ = true;
 }
 
 void Object::print()
 {
-	for (size_t i=0; i<vb.size(); ++i)
+	for (size_t i=0; i<mesh_.vertex_count; ++i)
   {
-    const glm::vec3& p = vb[i];
+    const glm::vec3 p = MeshBuilder::position(mesh_, i);
 
     std::cout << "v " << p.x << " " << p.y << " " << p.z << std::endl;
   }
+
+	const std::vector<unsigned int>& ib = mesh_.ib;
+	for (size_t i=0; i+2<ib.size(); i+=3)
+	{
+		std::cout << "f " << ib[i] + 1 << " " << ib[i+1] + 1 << " " << ib[i+2] + 1 << std::endl;
+	}
+}
+
+bool Object::load_simple_obj(const std::string& filename, const VertexFormat& format,
+	unsigned int num_threads, bool optimize)
+{
+	Mesh mesh;
+	if (!load_mesh(filename, format, num_threads, optimize, mesh))
+		return false;
+
+	set_mesh(mesh);
+	return true;
+}
+
+void Object::set_mesh(Mesh& mesh)
+{
+	std::swap(mesh_, mesh);
+	culled_ = false;
+
+	// the buffers no longer match the mesh
+	if (vbo_)
+		upload();
 }
 
-bool Object::load_simple_obj(const std::string& filename)
+void Object::set_placeholder()
 {
-	std::ifstream file(filename.c_str());
+	// corner i is at (x, y, z) = (i & 1, i >> 1 & 1, i >> 2 & 1) - 0.5
+	static const unsigned int faces[36] = {
+		0, 4, 6,  0, 6, 2,		// -x
+		1, 3, 7,  1, 7, 5,		// +x
+		0, 1, 5,  0, 5, 4,		// -y
+		2, 6, 7,  2, 7, 3,		// +y
+		0, 2, 3,  0, 3, 1,		// -z
+		4, 5, 7,  4, 7, 6			// +z
+	};
 
-	if (!file.is_open())
+	Mesh box;
+	box.vertex_count = 8;
+	box.vb.resize(box.format.buffer_size(8));
+	for (int i = 0; i < 8; ++i)
 	{
-		std::cerr << "failed to open file: " << filename << std::endl;
-		return false;
+		const float p[3] = { (i & 1) - 0.5f, (i >> 1 & 1) - 0.5f, (i >> 2 & 1) - 0.5f };
+		std::memcpy(&box.vb[i * box.format.stride()], p, sizeof(p));
 	}
+	box.ib.assign(faces, faces + 36);
+	Bounds::compute(box);
+	MeshletBuilder::build(box);
 
-	Object* obj = new Object();
+	set_mesh(box);
+}
 
-	std::vector<glm::vec3> tmp_vertices;
-	std::vector<glm::vec2> tmp_texcoords;
-	std::vector<glm::vec3> tmp_normals;
+bool Object::load_mesh(const std::string& filename, const VertexFormat& format,
+	unsigned int num_threads, bool optimize, Mesh& mesh)
+{
+	mesh.format = format;
+	mesh.optimized = optimize;
 
-	std::string line;
-	std::locale loc;
+	// parsed once, then read back from the binary cache while the source is unchanged
+	const std::string cache_file = filename + ".cache";
+	if (MeshCache::load(cache_file, filename, mesh))
+	{
+		Bounds::compute(mesh);
+		MeshletBuilder::build(mesh);
 
-	float x, y, z;
-	std::string type_str;
-	char slash;				// get only on character '\'
+		std::cout << "finished to read: " << cache_file << std::endl;
+		return true;
+	}
 
-	std::stringstream ss;
+	MappedFile file;
 
-	while (!file.eof())
+	if (!file.open(filename))
 	{
-		std::getline(file, line);
-
-		ss.clear();
-		ss.str(line);
-
-		// comment or space		
-		if (line[0] == '#' || std::isspace(line[0], loc))
-		{
-			continue; // skip
-		}
-		// vertex
-		else if (line.substr(0, 2) == "v ")
-		{
-			glm::vec3 vertex;
-			ss >> type_str >> vertex.x >> vertex.y >> vertex.z;
-			tmp_vertices.push_back(vertex);
-		}
-		// texture coordinate
-		else if (line.substr(0, 3) == "vt ")
-		{
-			glm::vec2 texcoord;
-			ss >> type_str >> texcoord.s >> texcoord.t;
-			tmp_texcoords.push_back(texcoord);
-		}
-		// vertex normal
-		else if (line.substr(0, 3) == "vn ")
-		{
-			glm::vec3 norm;
-			ss >> type_str >> norm.x >> norm.y >> norm.z;
-			tmp_normals.push_back(norm);
-		}
-		// faces
-		else if (line.substr(0, 2) == "f ")
-		{
-			glm::u16vec3 vert_idx;
-			glm::u16vec3 coord_idx;
-
-			ss >> type_str >> vert_idx.x >> slash >> coord_idx.x >>
-				vert_idx.y >> slash >> coord_idx.y >>
-				vert_idx.z >> slash >> coord_idx.z;
-
-			vb.push_back(tmp_vertices[vert_idx[0] - 1]);
-			vb.push_back(tmp_vertices[vert_idx[1] - 1]);
-			vb.push_back(tmp_vertices[vert_idx[2] - 1]);
-		}
+		std::cerr << "failed to open file: " << filename << std::endl;
+		return false;
 	}
-	
+
+	ObjData data;
+	const char* bad_line = (num_threads == 1)
+		? ObjParser::parse(file.begin(), file.end(), data)
+		: ObjParser::parse_parallel(file.begin(), file.end(), data, num_threads);
+	if (bad_line)
+	{
+		std::cerr << "failed to parse file: " << filename << " (line "
+			<< std::count(file.begin(), bad_line, '\n') + 1 << ")" << std::endl;
+		return false;
+	}
+
+	const ObjIndex* bad_corner = MeshBuilder::build(data, mesh);
+	if (bad_corner)
+	{
+		std::cerr << "invalid index " << bad_corner->v << "/" << bad_corner->vt << "/" << bad_corner->vn
+			<< " in file: " << filename << std::endl;
+		return false;
+	}
+
+	if (optimize)
+	{
+		const float acmr = MeshOptimizer::acmr(mesh.ib);
+		MeshOptimizer::optimize(mesh);
+
+		std::cout << "vertex cache ACMR: " << acmr << " -> " << MeshOptimizer::acmr(mesh.ib)
+			<< " (" << filename << ")" << std::endl;
+	}
+
+	MeshCache::save(cache_file, filename, file.begin(), file.end(), mesh);
+
+	Bounds::compute(mesh);
+	MeshletBuilder::build(mesh);
+
 	std::cout << "finished to read: " << filename << std::endl;
 	return true;
 }
@@ -4,16 +4,62 @@
 
 #include <glm/glm.hpp>
 
+#include "Mesh.h"
+
 class Object
 {
 public:
-  Object() {}
+  Object() : vbo_(0), ibo_(0), index_type_(0), culled_(false) {}
 
-  void draw(int loc_a_vertex);
+	// binds the attributes of the mesh format to the given locations; -1
+	// skips one. Quantized positions need the mesh position_offset and
+	// position_scale as uniforms (see shader/quantized.vert).
+  void draw(int loc_a_vertex, int loc_a_normal = -1, int loc_a_texcoord = -1,
+		int loc_a_tangent = -1, int loc_a_color = -1);
   void print();
+
+	// limits the following draws to the meshlets seen through pvm from camera
+	// (in model space); backface also drops meshlets facing away as a whole
+	void cull(const glm::mat4& pvm, const glm::vec3& camera, bool backface = true);
 	
-	bool load_simple_obj(const std::string& filename);
+	// reads the file into a mesh of the given format (see MeshBuilder);
+	// num_threads > 1 parses the file in parallel chunks (0: one per core)
+	// and optimize reorders the mesh for the vertex cache (see MeshOptimizer)
+	bool load_simple_obj(const std::string& filename,
+		const VertexFormat& format = VertexFormat(), unsigned int num_threads = 1,
+		bool optimize = false);
+
+	// the part of load_simple_obj that does not touch GL, so it can run on
+	// any thread
+	static bool load_mesh(const std::string& filename, const VertexFormat& format,
+		unsigned int num_threads, bool optimize, Mesh& mesh);
+
+	// takes mesh over (leaving the previous one in it) and uploads it if the
+	// buffers exist
+	void set_mesh(Mesh& mesh);
+
+	// a unit box around the origin, drawn while the real mesh is loading
+	void set_placeholder();
+
+	// copies the mesh into GL buffers; draw() does it on first use
+	void upload();
+
+	const Mesh&		mesh() const		{ return mesh_; }
+
+	// bounds of the mesh in model space, computed on load, and in the space
+	// that model maps to
+	const Aabb&						aabb() const		{ return mesh_.aabb; }
+	const BoundingSphere&	sphere() const	{ return mesh_.sphere; }
+	Aabb						aabb(const glm::mat4& model) const		{ return Bounds::transform(mesh_.aabb, model); }
+	BoundingSphere	sphere(const glm::mat4& model) const	{ return Bounds::transform(mesh_.sphere, model); }
 
 private:
-  std::vector<glm::vec3> vb;     // vertices  
-};
\ No newline at end of file
+	Mesh					mesh_;
+
+	unsigned int	vbo_, ibo_;
+	unsigned int	index_type_;	// GL_UNSIGNED_SHORT if the mesh fits, else GL_UNSIGNED_INT
+
+	// index ranges left by cull()
+	bool											culled_;
+	std::vector<unsigned int>	draw_first_, draw_count_;
+};
@@ -0,0 +1,164 @@
+#include "ProgramCache.h"
+#include <GL/glew.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "Checksum.h"
+#include "MappedFile.h"
+
+namespace {
+
+	std::string gl_string(GLenum name)
+	{
+		const GLubyte* s = glGetString(name);
+		return s ? reinterpret_cast<const char*>(s) : "";
+	}
+
+	// a binary in a format the driver no longer lists would only raise
+	// GL_INVALID_ENUM in glProgramBinary
+	bool accepts_format(GLenum format)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+		if (count <= 0)
+			return false;
+
+		std::vector<GLint> formats(count);
+		glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+		for (size_t i = 0; i < formats.size(); ++i)
+		{
+			if (static_cast<GLenum>(formats[i]) == format)
+				return true;
+		}
+		return false;
+	}
+
+}
+
+bool ProgramCache::supported()
+{
+	if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1)
+		return false;
+
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+	return count > 0;
+}
+
+uint64_t ProgramCache::driver_checksum()
+{
+	const std::string driver = gl_string(GL_VENDOR) + '\n' + gl_string(GL_RENDERER) + '\n' + gl_string(GL_VERSION);
+	return checksum(driver.data(), driver.data() + driver.size());
+}
+
+unsigned int ProgramCache::load(const std::string& cache_file, uint64_t source_checksum)
+{
+	if (!supported())
+		return 0;
+
+	MappedFile cache;
+	if (!cache.open(cache_file) || cache.size() < sizeof(ProgramCacheHeader))
+		return 0;
+
+	ProgramCacheHeader header;
+	std::memcpy(&header, cache.begin(), sizeof(header));
+
+	if (std::memcmp(header.magic, "PROG", 4) != 0 ||
+		header.version != kVersion ||
+		header.header_size != sizeof(ProgramCacheHeader) ||
+		header.source_checksum != source_checksum ||
+		header.driver_checksum != driver_checksum() ||
+		header.binary_size == 0 ||
+		header.binary_size != cache.size() - sizeof(ProgramCacheHeader))
+	{
+		return 0;
+	}
+
+	// drivers do not all survive a damaged binary
+	const char* binary = cache.begin() + sizeof(ProgramCacheHeader);
+	if (checksum(binary, cache.end()) != header.binary_checksum ||
+		!accepts_format(header.binary_format))
+	{
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	if (program == 0)
+		return 0;
+
+	glProgramBinary(program, header.binary_format, binary, static_cast<GLsizei>(header.binary_size));
+
+	int link_status;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+bool ProgramCache::save(const std::string& cache_file, uint64_t source_checksum, unsigned int program)
+{
+	if (!supported())
+		return false;
+
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0)
+		return false;
+
+	std::vector<char> binary(size);
+	GLenum format = 0;
+	GLsizei length = 0;
+	glGetProgramBinary(program, size, &length, &format, binary.data());
+	if (length <= 0)
+		return false;
+	binary.resize(length);
+
+	ProgramCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, "PROG", 4);
+	header.version = kVersion;
+	header.header_size = sizeof(ProgramCacheHeader);
+	header.binary_format = format;
+	header.source_checksum = source_checksum;
+	header.driver_checksum = driver_checksum();
+	header.binary_size = binary.size();
+	header.binary_checksum = checksum(binary.data(), binary.data() + binary.size());
+
+	// written under a temporary name so that a reader never maps a partial file
+	const std::string tmp_file = cache_file + ".tmp";
+	std::ofstream file(tmp_file.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "failed to write program cache: " << cache_file << std::endl;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), binary.size());
+
+	file.close();
+	if (!file)
+	{
+		std::cerr << "failed to write program cache: " << cache_file << std::endl;
+		std::remove(tmp_file.c_str());
+		return false;
+	}
+
+	std::remove(cache_file.c_str());
+	if (std::rename(tmp_file.c_str(), cache_file.c_str()) != 0)
+	{
+		std::cerr << "failed to write program cache: " << cache_file << std::endl;
+		std::remove(tmp_file.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Disk cache of linked GL programs (GL_ARB_get_program_binary).
+//
+// Layout (native byte order): a ProgramCacheHeader, then the driver's program
+// binary. The header records a checksum of the shader sources and one of the
+// GL vendor, renderer and version strings; a binary is only handed back to
+// the driver when both match, and a program the driver still rejects is
+// recompiled by the caller.
+struct ProgramCacheHeader
+{
+	char			magic[4];					// "PROG"
+	uint32_t	version;
+	uint32_t	header_size;
+	uint32_t	binary_format;		// from glGetProgramBinary
+
+	uint64_t	source_checksum;
+	uint64_t	driver_checksum;
+
+	uint64_t	binary_size;			// bytes after the header
+	uint64_t	binary_checksum;
+};
+
+class ProgramCache
+{
+public:
+	static const uint32_t kVersion = 1;
+
+	// whether the current context can save and load program binaries
+	static bool supported();
+
+	// checksum of the GL vendor, renderer and version of the current context
+	static uint64_t driver_checksum();
+
+	// a program linked from cache_file if it holds a binary of the sources
+	// with source_checksum for the current driver, otherwise 0
+	static unsigned int load(const std::string& cache_file, uint64_t source_checksum);
+
+	// writes the binary of the linked program to cache_file; the program
+	// must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	static bool save(const std::string& cache_file, uint64_t source_checksum, unsigned int program);
+};
@@ -1,9 +1,104 @@
 #include "Shader.h"
 #include <GL/glew.h>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <string>
 
+#include "Checksum.h"
+#include "ProgramCache.h"
+
+namespace {
+
+	bool read_source(const std::string& filename, std::string& source)
+	{
+		std::ifstream shader_file(filename.c_str());
+		if (!shader_file.is_open())
+		{
+			std::cerr << "failed to open shader: " << filename << std::endl;
+			return false;
+		}
+
+		source.assign(
+			(std::istreambuf_iterator<char>(shader_file)),
+			std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	// source with prologue inserted after its #version line, which must stay
+	// the first one, or at the start
+	std::string inject(const std::string& source, const std::string& prologue)
+	{
+		if (prologue.empty())
+			return source;
+
+		size_t line = 0;
+		while (line < source.size())
+		{
+			const size_t first = source.find_first_not_of(" \t", line);
+			const size_t end = source.find('\n', line);
+			if (first != std::string::npos && source.compare(first, 8, "#version") == 0)
+			{
+				const size_t next = (end == std::string::npos) ? source.size() : end + 1;
+				return source.substr(0, next) + ((end == std::string::npos) ? "\n" : "") + prologue + source.substr(next);
+			}
+			if (end == std::string::npos)
+				break;
+			line = end + 1;
+		}
+
+		return prologue + source;
+	}
+
+	// ./shader/simple.vert and ./shader/simple.frag: ./shader/simple.vert+simple.frag.program,
+	// with the checksum of the defines in hex before .program if there are any
+	std::string program_cache_file(const std::string& vertex_filename, const std::string& fragment_filename,
+		const std::string& prologue)
+	{
+		const size_t slash = fragment_filename.find_last_of("/\\");
+		const std::string fragment_name = (slash == std::string::npos) ? fragment_filename : fragment_filename.substr(slash + 1);
+		if (prologue.empty())
+			return vertex_filename + "+" + fragment_name + ".program";
+
+		char hex[17];
+		std::snprintf(hex, sizeof(hex), "%016llx",
+			static_cast<unsigned long long>(checksum(prologue.data(), prologue.data() + prologue.size())));
+		return vertex_filename + "+" + fragment_name + "." + hex + ".program";
+	}
+
+	GLuint compile_shader(int shader_type, const std::string& source, const std::string& filename)
+	{
+		GLuint shader = glCreateShader(shader_type);
+		if (shader != 0)
+		{
+			const GLchar* shader_src = source.c_str();
+			glShaderSource(shader, 1, (const GLchar**)&shader_src, NULL);
+			glCompileShader(shader);
+
+			int compiled;
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+			if (compiled != GL_TRUE)
+			{
+				std::cerr << "could not compile shader:" << filename << std::endl;
+
+				int bufflen;
+				glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &bufflen);
+
+				GLchar* infolog = new GLchar[bufflen + 1];
+				glGetShaderInfoLog(shader, bufflen, 0, infolog);
+				std::cerr << infolog << std::endl;
+				delete[] infolog;
+
+				glDeleteShader(shader);
+				shader = 0;
+			}
+		}
+
+		return shader;
+	}
+
+}
+
 void Shader::check_gl_error(const std::string& op)
 {
 	int error;
@@ -41,24 +136,64 @@ void Shader::check_gl_error(const std::string& op)
 
 int Shader::create_program(const std::string& vertex_filename, const std::string& fragment_filename)
 {
-	GLuint vertex_shader = create_shader(GL_VERTEX_SHADER, vertex_filename);
+	return create_program(vertex_filename, fragment_filename, std::vector<std::string>());
+}
+
+int Shader::create_program(const std::string& vertex_filename, const std::string& fragment_filename,
+	const std::vector<std::string>& defines)
+{
+	std::string vertex_source, fragment_source;
+	if (!read_source(vertex_filename, vertex_source) || !read_source(fragment_filename, fragment_source))
+	{
+		return 0;
+	}
+
+	std::string prologue;
+	for (size_t i = 0; i < defines.size(); ++i)
+	{
+		prologue += "#define " + defines[i] + "\n";
+	}
+	vertex_source = inject(vertex_source, prologue);
+	fragment_source = inject(fragment_source, prologue);
+
+	// linked programs are kept on disk (ProgramCache) while the sources and
+	// the driver are unchanged
+	const std::string sources = vertex_source + '\0' + fragment_source;
+	const uint64_t source_checksum = checksum(sources.data(), sources.data() + sources.size());
+	const std::string cache_file = program_cache_file(vertex_filename, fragment_filename, prologue);
+
+	GLuint program = ProgramCache::load(cache_file, source_checksum);
+	if (program != 0)
+	{
+		return program;
+	}
+
+	GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source, vertex_filename);
 	if (vertex_shader == 0) 
 	{
 		return 0;
 	}
 
-	GLuint fragment_shader = create_shader(GL_FRAGMENT_SHADER, fragment_filename);
+	GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source, fragment_filename);
 	if (fragment_shader == 0)
 	{
+		glDeleteShader(vertex_shader);
 		return 0;
 	}
 
-	GLuint program = glCreateProgram();
+	const bool cached = ProgramCache::supported();
+
+	program = glCreateProgram();
 	if (program != 0)
 	{
 		glAttachShader(program, vertex_shader);		
 		glAttachShader(program, fragment_shader);
 
+		if (cached)
+		{
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
 		glLinkProgram(program);
 
 		int link_status;
@@ -73,52 +208,31 @@ int Shader::create_program(const std::string& vertex_filename, const std::string
 			GLchar* infolog = new GLchar[bufflen + 1];
 			glGetProgramInfoLog(program, bufflen, 0, infolog);
 			std::cerr << infolog << std::endl;
-			delete infolog;
+			delete[] infolog;
 
 			glDeleteProgram(program);
 			program = 0;
 		}
+		else if (cached)
+		{
+			ProgramCache::save(cache_file, source_checksum, program);
+		}
 	}
 
+	// freed with the program
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
 	return program;
 }
 
 int Shader::create_shader(int shader_type, const std::string& filename)
 {
-	GLuint  shader = 0;
-	shader = glCreateShader(shader_type);
-	
-	if (shader != 0) 
+	std::string source;
+	if (!read_source(filename, source))
 	{
-		std::ifstream shader_file(filename.c_str());
-		std::string   shader_string;
-
-		shader_string.assign(
-			(std::istreambuf_iterator<char>(shader_file)),
-			std::istreambuf_iterator<char>());
-
-		const GLchar* shader_src = shader_string.c_str();
-		glShaderSource(shader, 1, (const GLchar**)&shader_src, NULL);
-		glCompileShader(shader);
-
-		int compiled;
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-		if (compiled != GL_TRUE)
-		{
-			std::cerr << "could not compile shader:" << filename << std::endl;
-
-			int bufflen;
-			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &bufflen);
-			
-			GLchar* infolog = new GLchar[bufflen + 1];
-			glGetShaderInfoLog(shader, bufflen, 0, infolog);
-			std::cerr << infolog << std::endl;
-			delete infolog;
-
-			glDeleteShader(shader);
-			shader = 0;
-		}
+		return 0;
 	}
 
-	return shader;
+	return compile_shader(shader_type, source, filename);
 }
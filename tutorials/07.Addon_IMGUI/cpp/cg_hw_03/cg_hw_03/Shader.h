@@ -1,13 +1,22 @@
 #pragma once
 #include <string>
+#include <vector>
 
 class Shader
 {
 public:
 	static void check_gl_error(const std::string& op);
 
-	static int create_program(const std::string& vertex_source, const std::string& fragment_source);
+	// links the program of the two shader files; the linked binary is kept
+	// next to the vertex shader (ProgramCache) and reused on later runs while
+	// the sources and the GL driver are unchanged
+	static int create_program(const std::string& vertex_filename, const std::string& fragment_filename);
+
+	// the same with a "#define <define>" line per define ("TEXTURED",
+	// "MAX_LIGHTS 4") put in front of both sources, after any #version line;
+	// each set of defines has its own cache file (see ShaderPermutations)
+	static int create_program(const std::string& vertex_filename, const std::string& fragment_filename,
+		const std::vector<std::string>& defines);
 
 	static int create_shader(int shaderType, const std::string& filename);
 };
-
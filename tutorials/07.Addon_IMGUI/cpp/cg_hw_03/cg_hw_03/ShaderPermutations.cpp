@@ -0,0 +1,41 @@
+#include "ShaderPermutations.h"
+#include <GL/glew.h>
+
+#include <algorithm>
+
+#include "Shader.h"
+
+ShaderPermutations::ShaderPermutations(const std::string& vertex_filename, const std::string& fragment_filename)
+	: vertex_filename_(vertex_filename), fragment_filename_(fragment_filename)
+{
+}
+
+unsigned int ShaderPermutations::program(const std::vector<std::string>& defines)
+{
+	// the same set in another order, or with repeats, is the same variant
+	std::vector<std::string> sorted(defines);
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+	std::string key;
+	for (size_t i = 0; i < sorted.size(); ++i)
+		key += sorted[i] + '\n';
+
+	std::unordered_map<std::string, unsigned int>::const_iterator it = programs_.find(key);
+	if (it != programs_.end())
+		return it->second;
+
+	const int program = Shader::create_program(vertex_filename_, fragment_filename_, sorted);
+	programs_[key] = program;
+	return program;
+}
+
+void ShaderPermutations::clear()
+{
+	for (std::unordered_map<std::string, unsigned int>::const_iterator it = programs_.begin(); it != programs_.end(); ++it)
+	{
+		if (it->second != 0)
+			glDeleteProgram(it->second);
+	}
+	programs_.clear();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Variants of one vertex/fragment shader pair, each selected by a set of
+// feature defines (see Shader::create_program). A variant is compiled, or
+// read from the program cache, the first time it is asked for and then
+// looked up by its sorted defines, so variants never drawn cost nothing and
+// need no source files of their own.
+class ShaderPermutations
+{
+public:
+	ShaderPermutations(const std::string& vertex_filename, const std::string& fragment_filename);
+
+	// the program of the variant with the given defines, in any order;
+	// 0 if it failed to build, which is not retried. On the GL thread.
+	unsigned int program(const std::vector<std::string>& defines = std::vector<std::string>());
+
+	// number of variants built so far
+	size_t size() const		{ return programs_.size(); }
+
+	// deletes the programs; needs the GL context
+	void clear();
+
+private:
+	std::string																vertex_filename_;
+	std::string																fragment_filename_;
+	std::unordered_map<std::string, unsigned int>	programs_;		// by the sorted defines, one per line
+};
@@ -0,0 +1,66 @@
+#include "VertexFormat.h"
+
+namespace {
+
+	size_t align4(size_t n)
+	{
+		return (n + 3) & ~size_t(3);
+	}
+
+}
+
+size_t VertexFormat::size(Attribute attribute) const
+{
+	const bool quantized = (encoding != FLOAT);
+	switch (attribute)
+	{
+	case POSITION:	return quantized ? 4 * 2 : 3 * 4;		// xyz + padding in 16 bits
+	case NORMAL:		return (encoding == QUANTIZED_OCT8) ? 2 * 1 : quantized ? 2 * 2 : 3 * 4;
+	case TEXCOORD:	return quantized ? 2 * 2 : 2 * 4;
+	case TANGENT:		return quantized ? 4 * 1 : 4 * 4;
+	case COLOR:			return 4 * 1;
+	}
+	return 0;
+}
+
+size_t VertexFormat::stride() const
+{
+	size_t n = 0;
+	for (int i = 0; i < kNumAttributes; ++i)
+	{
+		if (has(attribute(i)))
+			n += align4(size(attribute(i)));
+	}
+	return n;
+}
+
+size_t VertexFormat::offset(Attribute a, size_t vertex_count) const
+{
+	// bytes of the attributes, or streams, stored before a
+	size_t n = 0;
+	for (int i = 0; i < kNumAttributes && attribute(i) != a; ++i)
+	{
+		if (has(attribute(i)))
+			n += align4((layout == INTERLEAVED) ? size(attribute(i)) : size(attribute(i)) * vertex_count);
+	}
+	return n;
+}
+
+size_t VertexFormat::step(Attribute a) const
+{
+	return (layout == INTERLEAVED) ? stride() : size(a);
+}
+
+size_t VertexFormat::buffer_size(size_t vertex_count) const
+{
+	if (layout == INTERLEAVED)
+		return stride() * vertex_count;
+
+	size_t n = 0;
+	for (int i = 0; i < kNumAttributes; ++i)
+	{
+		if (has(attribute(i)))
+			n += align4(size(attribute(i)) * vertex_count);
+	}
+	return n;
+}
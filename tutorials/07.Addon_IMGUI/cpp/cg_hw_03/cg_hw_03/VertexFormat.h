@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+
+// Attributes stored for each vertex of an Object, their encoding and their
+// arrangement in its vertex buffer. Offsets and sizes are in bytes; every
+// attribute of an interleaved vertex and every stream starts on a 4-byte
+// boundary.
+struct VertexFormat
+{
+	enum Attribute
+	{
+		POSITION	= 1 << 0,
+		NORMAL		= 1 << 1,
+		TEXCOORD	= 1 << 2,
+		TANGENT		= 1 << 3,		// xyz and the bitangent sign in w
+		COLOR			= 1 << 4		// RGBA, 4 unsigned bytes
+	};
+
+	static const int kNumAttributes = 5;
+
+	enum Layout
+	{
+		INTERLEAVED,		// one stream: p n t p n t ...
+		SPLIT						// one stream per attribute: p p ... n n ... t t ...
+	};
+
+	enum Encoding
+	{
+		FLOAT,					// 32-bit floats
+		QUANTIZED,			// 16-bit unsigned normalized positions within the mesh
+										// bounds (Mesh::position_offset/scale), 2x16-bit
+										// octahedral normals, half-float texcoords and 8-bit
+										// signed normalized tangents
+		QUANTIZED_OCT8	// QUANTIZED with 2x8-bit octahedral normals, which only
+										// take less room than 2x16 bits in the SPLIT layout
+	};
+
+	unsigned int	attributes;		// Attribute bits; POSITION is always set
+	Layout				layout;
+	Encoding			encoding;
+
+	// TANGENT brings NORMAL and TEXCOORD along, since it is derived from them
+	VertexFormat(unsigned int attributes = POSITION, Layout layout = INTERLEAVED,
+		Encoding encoding = FLOAT)
+		: attributes(attributes | POSITION | ((attributes & TANGENT) ? NORMAL | TEXCOORD : 0)),
+			layout(layout), encoding(encoding) {}
+
+	bool has(Attribute attribute) const	{ return (attributes & attribute) != 0; }
+
+	// the i-th attribute in buffer order
+	static Attribute attribute(int i)		{ return static_cast<Attribute>(1 << i); }
+
+	// bytes of one attribute value
+	size_t size(Attribute attribute) const;
+
+	// bytes of one interleaved vertex
+	size_t stride() const;
+
+	// position of the attribute of vertex 0 in a buffer of vertex_count
+	// vertices, and the distance between consecutive vertices
+	size_t offset(Attribute attribute, size_t vertex_count) const;
+	size_t step(Attribute attribute) const;
+
+	// bytes of a buffer of vertex_count vertices
+	size_t buffer_size(size_t vertex_count) const;
+
+	bool operator==(const VertexFormat& other) const
+	{
+		return attributes == other.attributes && layout == other.layout && encoding == other.encoding;
+	}
+	bool operator!=(const VertexFormat& other) const { return !(*this == other); }
+};
@@ -0,0 +1,208 @@
+// Benchmark of the OBJ loader: MappedFile + ObjParser, serial and parallel,
+// against the previous getline/stringstream loop of Object::load_simple_obj.
+//
+// Generates a grid mesh with positions, texture coordinates and v/vt
+// triangles, loads it with every loader, checks that they produce the same
+// triangle list and reports the time and throughput of each.
+//
+//   make && ./bench_obj [grid size (default 1000)] [file (default bench_mesh.obj)]
+//
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+#include "ObjParser.h"
+
+// Object::load_simple_obj before the mapped parser (with int instead of
+// 16-bit indices so that the generated mesh can exceed 65535 vertices)
+bool legacy_load(const std::string& filename, std::vector<glm::vec3>& vb)
+{
+	std::ifstream file(filename.c_str());
+
+	if (!file.is_open())
+	{
+		std::cerr << "failed to open file: " << filename << std::endl;
+		return false;
+	}
+
+	std::vector<glm::vec3> tmp_vertices;
+	std::vector<glm::vec2> tmp_texcoords;
+	std::vector<glm::vec3> tmp_normals;
+
+	std::string line;
+	std::locale loc;
+
+	std::string type_str;
+	char slash;				// get only on character '\'
+
+	std::stringstream ss;
+
+	while (!file.eof())
+	{
+		std::getline(file, line);
+
+		ss.clear();
+		ss.str(line);
+
+		// comment or space		
+		if (line[0] == '#' || std::isspace(line[0], loc))
+		{
+			continue; // skip
+		}
+		// vertex
+		else if (line.substr(0, 2) == "v ")
+		{
+			glm::vec3 vertex;
+			ss >> type_str >> vertex.x >> vertex.y >> vertex.z;
+			tmp_vertices.push_back(vertex);
+		}
+		// texture coordinate
+		else if (line.substr(0, 3) == "vt ")
+		{
+			glm::vec2 texcoord;
+			ss >> type_str >> texcoord.s >> texcoord.t;
+			tmp_texcoords.push_back(texcoord);
+		}
+		// vertex normal
+		else if (line.substr(0, 3) == "vn ")
+		{
+			glm::vec3 norm;
+			ss >> type_str >> norm.x >> norm.y >> norm.z;
+			tmp_normals.push_back(norm);
+		}
+		// faces
+		else if (line.substr(0, 2) == "f ")
+		{
+			glm::ivec3 vert_idx;
+			glm::ivec3 coord_idx;
+
+			ss >> type_str >> vert_idx.x >> slash >> coord_idx.x >>
+				vert_idx.y >> slash >> coord_idx.y >>
+				vert_idx.z >> slash >> coord_idx.z;
+
+			vb.push_back(tmp_vertices[vert_idx[0] - 1]);
+			vb.push_back(tmp_vertices[vert_idx[1] - 1]);
+			vb.push_back(tmp_vertices[vert_idx[2] - 1]);
+		}
+	}
+
+	return true;
+}
+
+bool mapped_load(const std::string& filename, std::vector<glm::vec3>& vb, unsigned int num_threads)
+{
+	MappedFile file;
+	if (!file.open(filename))
+		return false;
+
+	ObjData data;
+	const char* bad_line = (num_threads == 1)
+		? ObjParser::parse(file.begin(), file.end(), data)
+		: ObjParser::parse_parallel(file.begin(), file.end(), data, num_threads);
+	if (bad_line)
+		return false;
+
+	vb.reserve(data.corners.size());
+	for (size_t i = 0; i < data.corners.size(); ++i)
+		vb.push_back(data.positions[data.corners[i].v - 1]);
+
+	return true;
+}
+
+// n x n grid of vertices on a wavy surface, two triangles per cell
+void write_grid(const std::string& filename, int n)
+{
+	std::FILE* fp = std::fopen(filename.c_str(), "w");
+
+	std::fprintf(fp, "# %d x %d grid\n", n, n);
+	for (int j = 0; j < n; ++j)
+		for (int i = 0; i < n; ++i)
+		{
+			const float x = static_cast<float>(i) / (n - 1) * 10.0f - 5.0f;
+			const float z = static_cast<float>(j) / (n - 1) * 10.0f - 5.0f;
+			std::fprintf(fp, "v %f %f %f\n", x, 0.25f * std::sin(x) * std::cos(z), z);
+		}
+	for (int j = 0; j < n; ++j)
+		for (int i = 0; i < n; ++i)
+			std::fprintf(fp, "vt %f %f\n", static_cast<float>(i) / (n - 1), static_cast<float>(j) / (n - 1));
+	for (int j = 0; j + 1 < n; ++j)
+		for (int i = 0; i + 1 < n; ++i)
+		{
+			const int a = j * n + i + 1, b = a + 1, c = a + n, d = c + 1;
+			std::fprintf(fp, "f %d/%d %d/%d %d/%d\n", a, a, c, c, b, b);
+			std::fprintf(fp, "f %d/%d %d/%d %d/%d\n", b, b, c, c, d, d);
+		}
+
+	std::fclose(fp);
+}
+
+bool serial_load(const std::string& filename, std::vector<glm::vec3>& vb)
+{
+	return mapped_load(filename, vb, 1);
+}
+
+template <typename Load>
+double run(Load load, const std::string& filename, std::vector<glm::vec3>& vb)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	load(filename, vb);
+	const std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	const int n = (argc > 1) ? std::atoi(argv[1]) : 1000;
+	const std::string filename = (argc > 2) ? argv[2] : "bench_mesh.obj";
+
+	write_grid(filename, n);
+
+	MappedFile file;
+	file.open(filename);
+	const double mb = file.size() / (1024.0 * 1024.0);
+	file.close();
+
+	std::vector<glm::vec3> vb_legacy, vb_mapped;
+	const double t_legacy = run(legacy_load, filename, vb_legacy);
+	const double t_mapped = run(serial_load, filename, vb_mapped);
+
+	bool same = vb_legacy.size() == vb_mapped.size() &&
+		std::memcmp(vb_legacy.data(), vb_mapped.data(), vb_legacy.size() * sizeof(glm::vec3)) == 0;
+
+	std::printf("%s: %.1f MB, %zu triangles\n", filename.c_str(), mb, vb_mapped.size() / 3);
+	std::printf("legacy      %8.3f s  %8.1f MB/s\n", t_legacy, mb / t_legacy);
+	std::printf("mapped      %8.3f s  %8.1f MB/s  speedup %5.1fx\n", t_mapped, mb / t_mapped, t_legacy / t_mapped);
+
+	const unsigned int cores = std::max(4u, std::thread::hardware_concurrency());
+	for (unsigned int num_threads = 2; num_threads <= cores; num_threads *= 2)
+	{
+		std::vector<glm::vec3> vb_parallel;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		mapped_load(filename, vb_parallel, num_threads);
+		const double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		same = same && vb_parallel.size() == vb_mapped.size() &&
+			std::memcmp(vb_parallel.data(), vb_mapped.data(), vb_mapped.size() * sizeof(glm::vec3)) == 0;
+
+		std::printf("mapped x%-3u %8.3f s  %8.1f MB/s  speedup %5.1fx\n", num_threads, t, mb / t, t_legacy / t);
+	}
+
+	std::printf("triangle lists %s\n", same ? "identical" : "DIFFER");
+
+	std::remove(filename.c_str());
+	return same ? 0 : 1;
+}
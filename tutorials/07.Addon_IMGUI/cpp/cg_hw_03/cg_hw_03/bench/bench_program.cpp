@@ -0,0 +1,110 @@
+// Benchmark of the program binary cache: Shader::create_program with an empty
+// cache (compile and link, then glGetProgramBinary) against a filled one
+// (glProgramBinary), for the shader pairs of the studio.
+//
+// Checks that a cached program has the uniforms and attributes of the
+// compiled one, and that a damaged cache file falls back to compiling.
+// Runs on any driver with GL_ARB_get_program_binary, Mesa's software
+// renderer included:
+//
+//   make && LIBGL_ALWAYS_SOFTWARE=1 ./bench_program [shader dir (default ../shader)]
+//
+// (MESA_SHADER_CACHE_DISABLE=true also turns program binaries off in Mesa.)
+//
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "ProgramCache.h"
+#include "Shader.h"
+
+struct Pair
+{
+	const char*	vertex;
+	const char*	fragment;
+	const char*	uniform;
+	const char*	attribute;
+};
+
+const Pair kPairs[] = {
+	{ "simple.vert", "simple.frag", "u_pvm_matrix", "a_vertex" },
+	{ "quantized.vert", "quantized.frag", "u_position_scale", "a_normal" },
+};
+
+double create(const std::string& vertex, const std::string& fragment, int& program)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	program = Shader::create_program(vertex, fragment);
+	glFinish();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool same_interface(int a, int b, const Pair& pair)
+{
+	return a != 0 && b != 0 &&
+		glGetUniformLocation(a, pair.uniform) == glGetUniformLocation(b, pair.uniform) &&
+		glGetAttribLocation(a, pair.attribute) == glGetAttribLocation(b, pair.attribute);
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string dir = (argc > 1) ? argv[1] : "../shader";
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH);
+	glutCreateWindow("bench_program");
+	if (glewInit() != GLEW_OK)
+	{
+		std::fprintf(stderr, "failed to initialize GLEW\n");
+		return 1;
+	}
+
+	std::printf("%s, %s, %s\n", glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION));
+	if (!ProgramCache::supported())
+	{
+		std::printf("no program binary formats: every run compiles\n");
+		return 1;
+	}
+
+	bool ok = true;
+	for (size_t i = 0; i < sizeof(kPairs) / sizeof(kPairs[0]); ++i)
+	{
+		const Pair& pair = kPairs[i];
+		const std::string vertex = dir + "/" + pair.vertex;
+		const std::string fragment = dir + "/" + pair.fragment;
+		const std::string cache_file = vertex + "+" + pair.fragment + ".program";
+		std::remove(cache_file.c_str());
+
+		int compiled, cached, fallback;
+		const double t_compiled = create(vertex, fragment, compiled);
+		const double t_cached = create(vertex, fragment, cached);
+
+		// one flipped byte in the middle of the binary
+		{
+			std::fstream file(cache_file.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			file.seekg(0, std::ios::end);
+			const std::streamoff middle = sizeof(ProgramCacheHeader) + (static_cast<std::streamoff>(file.tellg()) - sizeof(ProgramCacheHeader)) / 2;
+			char c = 0;
+			file.seekg(middle);
+			file.get(c);
+			file.seekp(middle);
+			file.put(static_cast<char>(c ^ 0x5A));
+		}
+		const double t_fallback = create(vertex, fragment, fallback);
+
+		const bool same = same_interface(compiled, cached, pair) && same_interface(compiled, fallback, pair);
+		ok = ok && same;
+
+		std::printf("%-16s %-16s compiled %8.2f ms  cached %8.2f ms  speedup %5.1fx  damaged %8.2f ms  %s\n",
+			pair.vertex, pair.fragment, t_compiled, t_cached, t_compiled / t_cached, t_fallback,
+			same ? "same interface" : "DIFFER");
+
+		std::remove(cache_file.c_str());
+	}
+
+	return ok ? 0 : 1;
+}
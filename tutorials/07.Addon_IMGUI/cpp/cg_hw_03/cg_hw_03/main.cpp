@@ -7,9 +7,11 @@
 #include <string>
 #include <fstream>
 
+#include "AssetLoader.h"
 #include "Object.h"
 #include "Camera.h"
 #include "Shader.h"
+#include "ShaderPermutations.h"
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
@@ -21,6 +23,7 @@ void idle();
 void keyboard(unsigned char, int, int);
 void special(int, int, int);
 
+ShaderPermutations	g_programs("./shader/simple.vert", "./shader/simple.frag");
 GLuint		program;
 
 GLint			loc_a_vertex;
@@ -31,6 +34,9 @@ glm::mat4 mat_PVM;
 Object		g_desk, g_fan, g_sofa, g_tv;  // furniture
 Camera		g_camera;											// viewer (you)
 
+AssetLoader	g_loader;										// reads the furniture in the background
+const double kUploadBudgetMs = 4.0;				// of each frame, for meshes that arrived
+
 int main(int argc, char* argv[])
 {
   glutInit(&argc, argv);
@@ -60,16 +66,17 @@ int main(int argc, char* argv[])
 
 void init()
 {
-  g_desk.load_simple_obj("./data/desk.obj");
-  g_fan.load_simple_obj("./data/fan.obj");
-  g_sofa.load_simple_obj("./data/sofa.obj");
-  g_tv.load_simple_obj("./data/tv.obj");
+  // placeholders are drawn until the meshes arrive
+  g_loader.load(g_desk, "./data/desk.obj", VertexFormat(), true);
+  g_loader.load(g_fan, "./data/fan.obj", VertexFormat(), true);
+  g_loader.load(g_sofa, "./data/sofa.obj", VertexFormat(), true);
+  g_loader.load(g_tv, "./data/tv.obj", VertexFormat(), true);
 	
   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
   glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);    // for wireframe rendering  
 
-	program = Shader::create_program("./shader/simple.vert", "./shader/simple.frag");
+	program = g_programs.program();
 	
 	loc_u_pvm_matrix	= glGetUniformLocation(program, "u_pvm_matrix");
 
@@ -80,6 +87,8 @@ void display()
 {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	g_loader.finish_uploads(kUploadBudgetMs);
+
 	glUseProgram(program);
 
 	// Camera setting
@@ -100,6 +109,13 @@ void display()
 	 	
 	glUniformMatrix4fv(loc_u_pvm_matrix, 1, false, glm::value_ptr(mat_PVM));
 	
+	// meshlets outside the view are skipped; back faces stay, as they show
+	// in wireframe
+	g_desk.cull(mat_PVM, g_camera.position(), false);
+	g_fan.cull(mat_PVM, g_camera.position(), false);
+	g_sofa.cull(mat_PVM, g_camera.position(), false);
+	g_tv.cull(mat_PVM, g_camera.position(), false);
+
 	// TODO: draw furniture by properly transforming each object
 	g_desk.draw(loc_a_vertex);
 	g_fan.draw(loc_a_vertex);
@@ -0,0 +1,25 @@
+// Decodes Object meshes in the QUANTIZED / QUANTIZED_OCT8 vertex encodings.
+uniform mat4 u_pvm_matrix;
+uniform vec3 u_position_offset;   // Mesh::position_offset
+uniform vec3 u_position_scale;    // Mesh::position_scale
+
+attribute vec4 a_vertex;          // 16-bit unsigned normalized, in [0, 1]
+attribute vec2 a_normal;          // octahedral, signed normalized
+
+varying vec3 v_normal;
+
+vec2 sign_not_zero(vec2 v) {
+  return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 decode_octahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+    n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+  return normalize(n);
+}
+
+void main() {
+  v_normal = decode_octahedral(max(a_normal, -1.0));
+  gl_Position = u_pvm_matrix * vec4(a_vertex.xyz * u_position_scale + u_position_offset, 1.0);
+}
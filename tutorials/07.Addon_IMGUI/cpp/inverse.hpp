@@ -0,0 +1,253 @@
+#ifndef KMUVCL_GRAPHICS_INVERSE_HPP
+#define KMUVCL_GRAPHICS_INVERSE_HPP
+
+#include "vec.hpp"
+#include "mat.hpp"
+#include "operator.hpp"
+#include "simd.hpp"
+
+namespace kmuvcl {
+  namespace math {
+
+    // Closed-form determinants and inverses for 2x2, 3x3 and 4x4 matrices.
+    // The inverses require an invertible argument; a singular matrix yields
+    // inf/nan elements.
+
+    namespace detail {
+
+      /// 2x2 determinants of rows (r0, r1) over the column pairs
+      /// (0,1) (0,2) (0,3) (1,2) (1,3) (2,3)
+      template <typename T>
+      void minors2x2(const mat<4, 4, T>& A, unsigned int r0, unsigned int r1, T* m)
+      {
+        m[0] = A(r0, 0)*A(r1, 1) - A(r1, 0)*A(r0, 1);
+        m[1] = A(r0, 0)*A(r1, 2) - A(r1, 0)*A(r0, 2);
+        m[2] = A(r0, 0)*A(r1, 3) - A(r1, 0)*A(r0, 3);
+        m[3] = A(r0, 1)*A(r1, 2) - A(r1, 1)*A(r0, 2);
+        m[4] = A(r0, 1)*A(r1, 3) - A(r1, 1)*A(r0, 3);
+        m[5] = A(r0, 2)*A(r1, 3) - A(r1, 2)*A(r0, 3);
+      }
+
+      template <typename T>
+      T determinant(const mat<4, 4, T>& A)
+      {
+        T s[6], c[6];
+        minors2x2(A, 0, 1, s);
+        minors2x2(A, 2, 3, c);
+
+        return  s[0]*c[5] - s[1]*c[4] + s[2]*c[3] + s[3]*c[2] - s[4]*c[1] + s[5]*c[0];
+      }
+
+      /// inverse through the adjugate built from the same twelve 2x2 minors
+      template <typename T>
+      mat<4, 4, T> inverse(const mat<4, 4, T>& A)
+      {
+        T s[6], c[6];
+        minors2x2(A, 0, 1, s);
+        minors2x2(A, 2, 3, c);
+
+        const T inv_det = static_cast<T>(1) /
+          (s[0]*c[5] - s[1]*c[4] + s[2]*c[3] + s[3]*c[2] - s[4]*c[1] + s[5]*c[0]);
+
+        mat<4, 4, T> B;
+        B(0, 0) = ( A(1, 1)*c[5] - A(1, 2)*c[4] + A(1, 3)*c[3]) * inv_det;
+        B(0, 1) = (-A(0, 1)*c[5] + A(0, 2)*c[4] - A(0, 3)*c[3]) * inv_det;
+        B(0, 2) = ( A(3, 1)*s[5] - A(3, 2)*s[4] + A(3, 3)*s[3]) * inv_det;
+        B(0, 3) = (-A(2, 1)*s[5] + A(2, 2)*s[4] - A(2, 3)*s[3]) * inv_det;
+
+        B(1, 0) = (-A(1, 0)*c[5] + A(1, 2)*c[2] - A(1, 3)*c[1]) * inv_det;
+        B(1, 1) = ( A(0, 0)*c[5] - A(0, 2)*c[2] + A(0, 3)*c[1]) * inv_det;
+        B(1, 2) = (-A(3, 0)*s[5] + A(3, 2)*s[2] - A(3, 3)*s[1]) * inv_det;
+        B(1, 3) = ( A(2, 0)*s[5] - A(2, 2)*s[2] + A(2, 3)*s[1]) * inv_det;
+
+        B(2, 0) = ( A(1, 0)*c[4] - A(1, 1)*c[2] + A(1, 3)*c[0]) * inv_det;
+        B(2, 1) = (-A(0, 0)*c[4] + A(0, 1)*c[2] - A(0, 3)*c[0]) * inv_det;
+        B(2, 2) = ( A(3, 0)*s[4] - A(3, 1)*s[2] + A(3, 3)*s[0]) * inv_det;
+        B(2, 3) = (-A(2, 0)*s[4] + A(2, 1)*s[2] - A(2, 3)*s[0]) * inv_det;
+
+        B(3, 0) = (-A(1, 0)*c[3] + A(1, 1)*c[1] - A(1, 2)*c[0]) * inv_det;
+        B(3, 1) = ( A(0, 0)*c[3] - A(0, 1)*c[1] + A(0, 2)*c[0]) * inv_det;
+        B(3, 2) = (-A(3, 0)*s[3] + A(3, 1)*s[1] - A(3, 2)*s[0]) * inv_det;
+        B(3, 3) = ( A(2, 0)*s[3] - A(2, 1)*s[1] + A(2, 2)*s[0]) * inv_det;
+
+        return  B;
+      }
+
+      /// rows of L^{-1} for the upper-left 3x3 block L of A:
+      /// (c1 x c2, c2 x c0, c0 x c1) / det(L) for the columns c_j of L
+      template <typename T>
+      void inverse3x3_rows(const mat<4, 4, T>& A, vec<3, T>* rows)
+      {
+        const vec<3, T> c0(A(0, 0), A(1, 0), A(2, 0));
+        const vec<3, T> c1(A(0, 1), A(1, 1), A(2, 1));
+        const vec<3, T> c2(A(0, 2), A(1, 2), A(2, 2));
+
+        rows[0] = cross(c1, c2);
+        rows[1] = cross(c2, c0);
+        rows[2] = cross(c0, c1);
+
+        const T inv_det = static_cast<T>(1) / dot(c0, rows[0]);
+        for (unsigned int i = 0; i < 3; ++i)
+          rows[i] = inv_det * rows[i];
+      }
+
+      template <typename T>
+      mat<4, 4, T> affine_inverse(const mat<4, 4, T>& A)
+      {
+        vec<3, T> rows[3];
+        inverse3x3_rows(A, rows);
+
+        const vec<3, T> t(A(0, 3), A(1, 3), A(2, 3));
+
+        mat<4, 4, T> B;
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+          B(i, 0) = rows[i](0);
+          B(i, 1) = rows[i](1);
+          B(i, 2) = rows[i](2);
+          B(i, 3) = -dot(rows[i], t);
+        }
+        B(3, 3) = static_cast<T>(1);
+
+        return  B;
+      }
+
+      template <typename T>
+      mat<3, 3, T> inverse_transpose3x3(const mat<4, 4, T>& A)
+      {
+        vec<3, T> rows[3];
+        inverse3x3_rows(A, rows);
+
+        mat<3, 3, T> N;
+        for (unsigned int j = 0; j < 3; ++j)
+          N.set_ith_column(j, rows[j]);
+
+        return  N;
+      }
+
+#ifdef KMUVCL_USE_SSE
+      inline float determinant(const mat<4, 4, float>& A)
+      {
+        return  simd::mat4_determinant(A);
+      }
+
+      inline mat<4, 4, float> inverse(const mat<4, 4, float>& A)
+      {
+        mat<4, 4, float>  B;
+        simd::mat4_inverse(A, B);
+        return  B;
+      }
+
+      inline mat<4, 4, float> affine_inverse(const mat<4, 4, float>& A)
+      {
+        mat<4, 4, float>  B;
+        simd::mat4_affine_inverse(A, B);
+        return  B;
+      }
+
+      inline mat<3, 3, float> inverse_transpose3x3(const mat<4, 4, float>& A)
+      {
+        alignas(16) float cols[12];
+        simd::mat4_inverse_transpose3x3(A, cols);
+
+        mat<3, 3, float>  N;
+        for (unsigned int j = 0; j < 3; ++j)
+          for (unsigned int i = 0; i < 3; ++i)
+            N(i, j) = cols[4*j + i];
+
+        return  N;
+      }
+#endif // KMUVCL_USE_SSE
+
+    } // detail
+
+    /// det(A_{2x2})
+    template <typename T, typename E>
+    T determinant(const mat_expr<2, 2, T, E>& expr)
+    {
+      const E& A = expr.self();
+      return  A(0, 0)*A(1, 1) - A(0, 1)*A(1, 0);
+    }
+
+    /// det(A_{3x3})
+    template <typename T, typename E>
+    T determinant(const mat_expr<3, 3, T, E>& expr)
+    {
+      const mat<3, 3, T>& A = detail::eval(expr.self());
+      return  A(0, 0)*(A(1, 1)*A(2, 2) - A(2, 1)*A(1, 2))
+            - A(0, 1)*(A(1, 0)*A(2, 2) - A(2, 0)*A(1, 2))
+            + A(0, 2)*(A(1, 0)*A(2, 1) - A(2, 0)*A(1, 1));
+    }
+
+    /// det(A_{4x4})
+    template <typename T, typename E>
+    T determinant(const mat_expr<4, 4, T, E>& A)
+    {
+      return  detail::determinant(detail::eval(A.self()));
+    }
+
+    /// A_{2x2}^{-1}
+    template <typename T, typename E>
+    mat<2, 2, T> inverse(const mat_expr<2, 2, T, E>& expr)
+    {
+      const mat<2, 2, T>& A = detail::eval(expr.self());
+      const T inv_det = static_cast<T>(1) / (A(0, 0)*A(1, 1) - A(0, 1)*A(1, 0));
+
+      mat<2, 2, T> B;
+      B(0, 0) =  A(1, 1) * inv_det;
+      B(0, 1) = -A(0, 1) * inv_det;
+      B(1, 0) = -A(1, 0) * inv_det;
+      B(1, 1) =  A(0, 0) * inv_det;
+
+      return  B;
+    }
+
+    /// A_{3x3}^{-1}, whose rows are (c1 x c2, c2 x c0, c0 x c1) / det(A)
+    template <typename T, typename E>
+    mat<3, 3, T> inverse(const mat_expr<3, 3, T, E>& expr)
+    {
+      const mat<3, 3, T>& A = detail::eval(expr.self());
+      vec<3, T> c0, c1, c2;
+      A.get_ith_column(0, c0);
+      A.get_ith_column(1, c1);
+      A.get_ith_column(2, c2);
+
+      const vec<3, T> r0 = cross(c1, c2);
+      const T inv_det = static_cast<T>(1) / dot(c0, r0);
+
+      mat<3, 3, T> B;
+      B.set_ith_row(0, inv_det * r0);
+      B.set_ith_row(1, inv_det * cross(c2, c0));
+      B.set_ith_row(2, inv_det * cross(c0, c1));
+
+      return  B;
+    }
+
+    /// A_{4x4}^{-1}
+    template <typename T, typename E>
+    mat<4, 4, T> inverse(const mat_expr<4, 4, T, E>& A)
+    {
+      return  detail::inverse(detail::eval(A.self()));
+    }
+
+    /// [L | t]^{-1} = [L^{-1} | -L^{-1} t] for an affine transform whose
+    /// bottom row is (0, 0, 0, 1), e.g. any product of translate, rotate,
+    /// scale and lookAt; much cheaper than the general inverse
+    template <typename T, typename E>
+    mat<4, 4, T> affine_inverse(const mat_expr<4, 4, T, E>& A)
+    {
+      return  detail::affine_inverse(detail::eval(A.self()));
+    }
+
+    /// (L^{-1})^T for the upper-left 3x3 block L of A: the normal matrix of
+    /// a model(-view) matrix A
+    template <typename T, typename E>
+    mat<3, 3, T> inverse_transpose3x3(const mat_expr<4, 4, T, E>& A)
+    {
+      return  detail::inverse_transpose3x3(detail::eval(A.self()));
+    }
+
+  } // math
+} // kmuvcl
+
+#endif // KMUVCL_GRAPHICS_INVERSE_HPP
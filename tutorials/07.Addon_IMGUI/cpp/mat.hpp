@@ -4,95 +4,178 @@
 #include <iostream>
 #include <cstring>
 #include <cstdarg>
+#include <utility>
 
 namespace kmuvcl {
   namespace math {
 
+    /// storage alignment of mat<M, N, T>
     template <unsigned int M, unsigned int N, typename T>
-    class mat
+    struct mat_traits
+    {
+      static const unsigned int alignment = alignof(T);
+    };
+
+    /// each column of mat4f is loaded as one SSE register
+    template <>
+    struct mat_traits<4, 4, float>
+    {
+      static const unsigned int alignment = 16;
+    };
+
+    /// base of every MxN matrix expression; E is the derived type, which
+    /// provides T operator()(unsigned int r, unsigned int c) const
+    ///
+    /// Like vec_expr, matrix expressions are evaluated element-wise in a single
+    /// pass when they are assigned to a mat.
+    template <unsigned int M, unsigned int N, typename T, typename E>
+    class mat_expr
+    {
+    public:
+      constexpr const E& self() const
+      {
+        return  static_cast<const E&>(*this);
+      }
+    };
+
+    template <unsigned int M, unsigned int N, typename T>
+    class mat : public mat_expr<M, N, T, mat<M, N, T> >
     {
     public:
-      mat()
+      constexpr mat() : val()
+      {}
+
+      constexpr mat(const T elem) : val()
       {
-        set_to_zero();
+        for (unsigned int i = 0; i < M*N; ++i)
+          val[i] = elem;
       }
 
-      mat(const T elem)
+      /// val_i = gen(i) for every column-major index i, with the element list
+      /// expanded at compile time; nothing is zero-filled beforehand
+      template <typename Gen>
+      constexpr mat(const Gen& gen, generate_tag)
+        : mat(gen, std::make_integer_sequence<unsigned int, M*N>())
+      {}
+
+      /// evaluates a matrix expression without intermediate matrices
+      template <typename E>
+      constexpr mat(const mat_expr<M, N, T, E>& expr)
+        : mat(expr_gen<E>{ expr.self() }, generate_tag())
+      {}
+
+      template <typename E>
+      constexpr mat& operator= (const mat_expr<M, N, T, E>& expr)
       {
-        std::fill(val, val + M*N, elem);
+        const E& e = expr.self();
+        for (unsigned int c = 0; c < N; ++c)
+          for (unsigned int r = 0; r < M; ++r)
+            val[r + c*M] = e(r, c);
+
+        return  *this;
       }
 
-      T& operator()(unsigned int r, unsigned int c)
+      template <typename E>
+      constexpr mat& operator+=(const mat_expr<M, N, T, E>& expr)
+      {
+        const E& e = expr.self();
+        for (unsigned int c = 0; c < N; ++c)
+          for (unsigned int r = 0; r < M; ++r)
+            val[r + c*M] += e(r, c);
+
+        return  *this;
+      }
+
+      template <typename E>
+      constexpr mat& operator-=(const mat_expr<M, N, T, E>& expr)
+      {
+        const E& e = expr.self();
+        for (unsigned int c = 0; c < N; ++c)
+          for (unsigned int r = 0; r < M; ++r)
+            val[r + c*M] -= e(r, c);
+
+        return  *this;
+      }
+
+      constexpr T& operator()(unsigned int r, unsigned int c)
       {
         return  val[r + c*M];   // column major
       }
 
-      const T& operator()(unsigned int r, unsigned int c) const
+      constexpr const T& operator()(unsigned int r, unsigned int c) const
       {
         return  val[r + c*M];   // column major
       }
 
       // type casting operators
-      operator const T* () const
+      constexpr operator const T* () const
       {
         return  val;
       }
 
-      operator T* ()
+      constexpr operator T* ()
       {
         return  val;
       }
 
-      void set_to_zero()
+      constexpr void set_to_zero()
       {
-        std::fill(val, val + M*N, static_cast<T>(0));
+        for (unsigned int i = 0; i < M*N; ++i)
+          val[i] = static_cast<T>(0);
       }
 
-      void get_ith_column(unsigned int i, vec<M, T>& col) const
+      constexpr void get_ith_column(unsigned int i, vec<M, T>& col) const
       {
-        T* dest       = (T*) col;
-        const T* src  = val + i*M;
-
-        std::memcpy(dest, src, sizeof(T)*M);
+        for (unsigned int r = 0; r < M; ++r)
+          col(r) = val[r + i*M];
       }
 
-      void set_ith_column(unsigned int i, const vec<M, T>& col)
+      constexpr void set_ith_column(unsigned int i, const vec<M, T>& col)
       {
-        T* dest       = val + i*M;
-        const T* src  = (const T*)col;
-
-        std::memcpy(dest, src, sizeof(T)*M);
+        for (unsigned int r = 0; r < M; ++r)
+          val[r + i*M] = col(r);
       }
 
-      void get_ith_row(unsigned int i, vec<N, T>& row) const
+      constexpr void get_ith_row(unsigned int i, vec<N, T>& row) const
       {
         for (unsigned int c = 0; c < N; ++c)
           row(c) = (*this)(i, c);
       }
 
-      void set_ith_row(unsigned int i, const vec<N, T>& row)
+      constexpr void set_ith_row(unsigned int i, const vec<N, T>& row)
       {
         for (unsigned int c = 0; c < N; ++c)
           (*this)(i, c) = row(c);
       }
 
-      mat<N, M, T> transpose() const
+      constexpr mat<N, M, T> transpose() const
       {
-        
-        mat<N, M, T>  trans;
-        vec<M, T>     col;
-
-        for (unsigned int i = 0; i < N; ++i)
-        {
-          get_ith_column(i, col);
-          trans.set_ith_row(i, col);
-        }
-
-        return  trans;
+        return  mat<N, M, T>(transpose_gen{ val }, generate_tag());
       }
 
     protected:
-      T val[M*N];   // column major
+      alignas(mat_traits<M, N, T>::alignment) T val[M*N];   // column major
+
+    private:
+      template <typename Gen, unsigned int... I>
+      constexpr mat(const Gen& gen, std::integer_sequence<unsigned int, I...>)
+        : val{ gen(I)... }
+      {}
+
+      // element i of an MxN expression is e(i % M, i / M)
+      template <typename E>
+      struct expr_gen
+      {
+        const E& e;
+        constexpr T operator()(unsigned int i) const { return  e(i % M, i / M); }
+      };
+
+      // element i of the NxM transpose is A(i / N, i % N)
+      struct transpose_gen
+      {
+        const T* a;
+        constexpr T operator()(unsigned int i) const { return  a[i / N + (i % N)*M]; }
+      };
     };
 
     typedef mat<3, 3, float>    mat3x3f;
@@ -3,128 +3,392 @@
 
 #include "vec.hpp"
 #include "mat.hpp"
+#include "simd.hpp"
 
 namespace kmuvcl {
   namespace math {
 
-    /// w_n = u_n + v_n
-    template <unsigned int N, typename T>
-    vec<N, T> operator+ (const vec<N, T>& u, const vec<N, T>& v)
+    namespace detail {
+
+      /// s = sum_{k<K} a[k*a_stride] * b[k*b_stride], expanded at compile time
+      template <unsigned int K>
+      struct dot_unroll
+      {
+        template <typename T>
+        static constexpr T apply(const T* a, unsigned int a_stride, const T* b, unsigned int b_stride)
+        {
+          return  dot_unroll<K - 1>::apply(a, a_stride, b, b_stride)
+                + a[(K - 1)*a_stride] * b[(K - 1)*b_stride];
+        }
+      };
+
+      template <>
+      struct dot_unroll<1>
+      {
+        template <typename T>
+        static constexpr T apply(const T* a, unsigned int, const T* b, unsigned int)
+        {
+          return  a[0] * b[0];
+        }
+      };
+
+      /// y_i = A(i, :) * x
+      template <unsigned int M, unsigned int N, typename T>
+      struct mat_vec_gen
+      {
+        const T* a;
+        const T* x;
+        constexpr T operator()(unsigned int i) const
+        {
+          return  dot_unroll<N>::apply(a + i, M, x, 1);
+        }
+      };
+
+      /// y_i = x * A(:, i)
+      template <unsigned int M, unsigned int N, typename T>
+      struct vec_mat_gen
+      {
+        const T* x;
+        const T* a;
+        constexpr T operator()(unsigned int i) const
+        {
+          return  dot_unroll<M>::apply(x, 1, a + i*M, 1);
+        }
+      };
+
+      /// C(r, c) = A(r, :) * B(:, c) for the column-major index i = r + c*M
+      template <unsigned int M, unsigned int N, unsigned int L, typename T>
+      struct mat_mat_gen
+      {
+        const T* a;
+        const T* b;
+        constexpr T operator()(unsigned int i) const
+        {
+          return  dot_unroll<N>::apply(a + i % M, M, b + (i / M)*N, 1);
+        }
+      };
+
+      struct op_add
+      {
+        template <typename T>
+        static constexpr T apply(const T& a, const T& b) { return  a + b; }
+      };
+
+      struct op_sub
+      {
+        template <typename T>
+        static constexpr T apply(const T& a, const T& b) { return  a - b; }
+      };
+
+      /// how an expression node stores an operand: vec and mat by reference,
+      /// other (small, temporary) expression nodes by value
+      template <typename E>
+      struct expr_ref
+      {
+        typedef const E type;
+      };
+
+      template <unsigned int N, typename T>
+      struct expr_ref< vec<N, T> >
+      {
+        typedef const vec<N, T>& type;
+      };
+
+      template <unsigned int M, unsigned int N, typename T>
+      struct expr_ref< mat<M, N, T> >
+      {
+        typedef const mat<M, N, T>& type;
+      };
+
+      /// the operand as a vec/mat: no copy for vec and mat, one evaluation
+      /// for any other expression
+      template <unsigned int N, typename T>
+      constexpr const vec<N, T>& eval(const vec<N, T>& v)
+      {
+        return  v;
+      }
+
+      template <unsigned int N, typename T, typename E>
+      constexpr vec<N, T> eval(const vec_expr<N, T, E>& e)
+      {
+        return  vec<N, T>(e);
+      }
+
+      template <unsigned int M, unsigned int N, typename T>
+      constexpr const mat<M, N, T>& eval(const mat<M, N, T>& A)
+      {
+        return  A;
+      }
+
+      template <unsigned int M, unsigned int N, typename T, typename E>
+      constexpr mat<M, N, T> eval(const mat_expr<M, N, T, E>& e)
+      {
+        return  mat<M, N, T>(e);
+      }
+
+      // Kernels behind the public functions below. The SIMD overloads are
+      // non-templates, so they win over the generic templates for vec4f and
+      // mat4f. Keeping them here rather than as public operator overloads
+      // leaves exactly one public template per operator for the expression
+      // types to bind to.
+      //
+      // vec3f dot and cross stay scalar: a vec3f is typically assembled from
+      // three scalar stores just before use, and reloading it as one 128-bit
+      // vector stalls on store forwarding (lookAt<float> ran ~3x slower).
+
+      template <unsigned int N, typename T>
+      constexpr T dot(const vec<N, T>& u, const vec<N, T>& v)
+      {
+        return  dot_unroll<N>::apply((const T*)u, 1, (const T*)v, 1);
+      }
+
+      template <typename T>
+      constexpr vec<3, T> cross(const vec<3, T>& u, const vec<3, T>& v)
+      {
+        return  vec<3, T>(u(1)*v(2) - u(2)*v(1),
+                          u(2)*v(0) - u(0)*v(2),
+                          u(0)*v(1) - u(1)*v(0));
+      }
+
+      template <unsigned int M, unsigned int N, typename T>
+      constexpr vec<M, T> mat_vec_mul(const mat<M, N, T>& A, const vec<N, T>& x)
+      {
+        return  vec<M, T>(mat_vec_gen<M, N, T>{ A, x }, generate_tag());
+      }
+
+      template <unsigned int M, unsigned int N, typename T>
+      constexpr vec<N, T> vec_mat_mul(const vec<M, T>& x, const mat<M, N, T>& A)
+      {
+        return  vec<N, T>(vec_mat_gen<M, N, T>{ x, A }, generate_tag());
+      }
+
+      template <unsigned int M, unsigned int N, unsigned int L, typename T>
+      constexpr mat<M, L, T> mat_mul(const mat<M, N, T>& A, const mat<N, L, T>& B)
+      {
+        return  mat<M, L, T>(mat_mat_gen<M, N, L, T>{ A, B }, generate_tag());
+      }
+
+#ifdef KMUVCL_USE_SSE
+      // Intrinsics cannot run at compile time, so in a constant expression
+      // these fall back to the generic templates above (see simd.hpp).
+
+      KMUVCL_SIMD_CONSTEXPR inline float dot(const vec<4, float>& u, const vec<4, float>& v)
+      {
+        if (KMUVCL_CONSTANT_EVALUATED())
+          return  dot<4, float>(u, v);
+
+        return  simd::vec4_dot(u, v);
+      }
+
+      KMUVCL_SIMD_CONSTEXPR inline vec<4, float> mat_vec_mul(const mat<4, 4, float>& A,
+                                                             const vec<4, float>& x)
+      {
+        if (KMUVCL_CONSTANT_EVALUATED())
+          return  mat_vec_mul<4, 4, float>(A, x);
+
+        vec<4, float>  y;
+        simd::mat4_mul_vec4(A, x, y);
+        return  y;
+      }
+
+      KMUVCL_SIMD_CONSTEXPR inline vec<4, float> vec_mat_mul(const vec<4, float>& x,
+                                                             const mat<4, 4, float>& A)
+      {
+        if (KMUVCL_CONSTANT_EVALUATED())
+          return  vec_mat_mul<4, 4, float>(x, A);
+
+        vec<4, float>  y;
+        simd::vec4_mul_mat4(x, A, y);
+        return  y;
+      }
+
+      KMUVCL_SIMD_CONSTEXPR inline mat<4, 4, float> mat_mul(const mat<4, 4, float>& A,
+                                                            const mat<4, 4, float>& B)
+      {
+        if (KMUVCL_CONSTANT_EVALUATED())
+          return  mat_mul<4, 4, 4, float>(A, B);
+
+        mat<4, 4, float>  C;
+        simd::mat4_mul(A, B, C);
+        return  C;
+      }
+#endif // KMUVCL_USE_SSE
+
+    } // detail
+
+    /// w_n = Op(u_n, v_n), evaluated lazily
+    template <unsigned int N, typename T, typename L, typename R, typename Op>
+    class vec_binary : public vec_expr<N, T, vec_binary<N, T, L, R, Op> >
     {
-      vec<N, T>  w;
+    public:
+      constexpr vec_binary(const L& u, const R& v) : u_(u), v_(v) {}
+
+      constexpr T operator()(unsigned int i) const
+      {
+        return  Op::apply(u_(i), v_(i));
+      }
 
-      for (unsigned int i = 0; i < N; ++i)
-        w(i) = u(i) + v(i);
+    private:
+      typename detail::expr_ref<L>::type  u_;
+      typename detail::expr_ref<R>::type  v_;
+    };
 
-      return  w;
-    }
+    /// y_n = s * x_n, evaluated lazily
+    template <unsigned int N, typename T, typename E>
+    class vec_scaled : public vec_expr<N, T, vec_scaled<N, T, E> >
+    {
+    public:
+      constexpr vec_scaled(const T s, const E& x) : s_(s), x_(x) {}
 
-    /// w_n = u_n - v_n
-    template <unsigned int N, typename T>
-    vec<N, T> operator- (const vec<N, T>& u, const vec<N, T>& v)
+      constexpr T operator()(unsigned int i) const
+      {
+        return  s_ * x_(i);
+      }
+
+    private:
+      T                                   s_;
+      typename detail::expr_ref<E>::type  x_;
+    };
+
+    /// C_{mxn} = Op(A_{mxn}, B_{mxn}), evaluated lazily
+    template <unsigned int M, unsigned int N, typename T, typename L, typename R, typename Op>
+    class mat_binary : public mat_expr<M, N, T, mat_binary<M, N, T, L, R, Op> >
     {
-      vec<N, T>  w;
+    public:
+      constexpr mat_binary(const L& A, const R& B) : A_(A), B_(B) {}
 
-      for (unsigned int i = 0; i < N; ++i)
-        w(i) = u(i) - v(i);
+      constexpr T operator()(unsigned int r, unsigned int c) const
+      {
+        return  Op::apply(A_(r, c), B_(r, c));
+      }
+
+    private:
+      typename detail::expr_ref<L>::type  A_;
+      typename detail::expr_ref<R>::type  B_;
+    };
+
+    /// B_{mxn} = s * A_{mxn}, evaluated lazily
+    template <unsigned int M, unsigned int N, typename T, typename E>
+    class mat_scaled : public mat_expr<M, N, T, mat_scaled<M, N, T, E> >
+    {
+    public:
+      constexpr mat_scaled(const T s, const E& A) : s_(s), A_(A) {}
 
-      return  w;
+      constexpr T operator()(unsigned int r, unsigned int c) const
+      {
+        return  s_ * A_(r, c);
+      }
+
+    private:
+      T                                   s_;
+      typename detail::expr_ref<E>::type  A_;
+    };
+
+    /// w_n = u_n + v_n
+    template <unsigned int N, typename T, typename L, typename R>
+    constexpr vec_binary<N, T, L, R, detail::op_add>
+    operator+ (const vec_expr<N, T, L>& u, const vec_expr<N, T, R>& v)
+    {
+      return  vec_binary<N, T, L, R, detail::op_add>(u.self(), v.self());
+    }
+
+    /// w_n = u_n - v_n
+    template <unsigned int N, typename T, typename L, typename R>
+    constexpr vec_binary<N, T, L, R, detail::op_sub>
+    operator- (const vec_expr<N, T, L>& u, const vec_expr<N, T, R>& v)
+    {
+      return  vec_binary<N, T, L, R, detail::op_sub>(u.self(), v.self());
     }
 
     /// y_n = s * x_n
-    template <unsigned int N, typename T>
-    vec<N, T> operator* (const T s, const vec<N, T>& x)
+    template <unsigned int N, typename T, typename E>
+    constexpr vec_scaled<N, T, E> operator* (const T s, const vec_expr<N, T, E>& x)
     {
-      vec<N, T>  y;
-      
-      for (unsigned int i = 0; i < N; ++i)
-        y(i) = s*x(i);
+      return  vec_scaled<N, T, E>(s, x.self());
+    }
 
-      return  y;
+    /// y_n = x_n * s
+    template <unsigned int N, typename T, typename E>
+    constexpr vec_scaled<N, T, E> operator* (const vec_expr<N, T, E>& x, const T s)
+    {
+      return  vec_scaled<N, T, E>(s, x.self());
     }
 
-    /// s = u_n * v_n (dot product)
-    template <unsigned int N, typename T>
-    T dot(const vec<N, T>& u, const vec<N, T>& v)
+    /// C_{mxn} = A_{mxn} + B_{mxn}
+    template <unsigned int M, unsigned int N, typename T, typename L, typename R>
+    constexpr mat_binary<M, N, T, L, R, detail::op_add>
+    operator+ (const mat_expr<M, N, T, L>& A, const mat_expr<M, N, T, R>& B)
     {
-      T val = 0;
-      
-      for (unsigned int i = 0; i < N; ++i)
-        val += u(i) * v(i);
+      return  mat_binary<M, N, T, L, R, detail::op_add>(A.self(), B.self());
+    }
 
-      return  val;
+    /// C_{mxn} = A_{mxn} - B_{mxn}
+    template <unsigned int M, unsigned int N, typename T, typename L, typename R>
+    constexpr mat_binary<M, N, T, L, R, detail::op_sub>
+    operator- (const mat_expr<M, N, T, L>& A, const mat_expr<M, N, T, R>& B)
+    {
+      return  mat_binary<M, N, T, L, R, detail::op_sub>(A.self(), B.self());
     }
 
-    /// w_3 = u_3 x v_3 (cross product, only for vec3)
-    template <typename T>
-    vec<3,T> cross(const vec<3, T>& u, const vec<3, T>& v)
+    /// B_{mxn} = s * A_{mxn}
+    template <unsigned int M, unsigned int N, typename T, typename E>
+    constexpr mat_scaled<M, N, T, E> operator* (const T s, const mat_expr<M, N, T, E>& A)
     {
-      vec<3, T>  w;
+      return  mat_scaled<M, N, T, E>(s, A.self());
+    }
 
-      w(0) = u(1)*v(2) - u(2)*v(1);
-      w(1) = u(2)*v(0) - u(0)*v(2);
-      w(2) = u(0)*v(1) - u(1)*v(0);
+    /// B_{mxn} = A_{mxn} * s
+    template <unsigned int M, unsigned int N, typename T, typename E>
+    constexpr mat_scaled<M, N, T, E> operator* (const mat_expr<M, N, T, E>& A, const T s)
+    {
+      return  mat_scaled<M, N, T, E>(s, A.self());
+    }
 
-      return  w;
+    /// s = u_n * v_n (dot product)
+    template <unsigned int N, typename T, typename L, typename R>
+    constexpr T dot(const vec_expr<N, T, L>& u, const vec_expr<N, T, R>& v)
+    {
+      return  detail::dot(detail::eval(u.self()), detail::eval(v.self()));
     }
 
-    /// y_m = A_{mxn} * x_n
-    template <unsigned int M, unsigned int N, typename T>
-    vec<M, T> operator* (const mat<M, N, T>& A, const vec<N, T>& x)
+    /// w_3 = u_3 x v_3 (cross product, only for vec3)
+    template <typename T, typename L, typename R>
+    constexpr vec<3, T> cross(const vec_expr<3, T, L>& u, const vec_expr<3, T, R>& v)
     {
-      vec<M, T>   y, col;
+      return  detail::cross(detail::eval(u.self()), detail::eval(v.self()));
+    }
 
-      for (unsigned int i = 0; i < N; ++i)
-      {
-        A.get_ith_column(i, col);
-        y += x(i)*col;
-      }        
+    // Products are evaluated eagerly: every element of the result reads a whole
+    // row or column of the operands, so a lazy product would redo that work
+    // per access and break for aliased assignments such as A = A * B.
 
-      return  y;
+    /// y_m = A_{mxn} * x_n
+    template <unsigned int M, unsigned int N, typename T, typename EA, typename EX>
+    constexpr vec<M, T> operator* (const mat_expr<M, N, T, EA>& A, const vec_expr<N, T, EX>& x)
+    {
+      return  detail::mat_vec_mul(detail::eval(A.self()), detail::eval(x.self()));
     }
 
     /// y_n = x_m * A_{mxn}
-    template <unsigned int M, unsigned int N, typename T>
-    vec<N, T> operator* (const vec<M, T>& x, const mat<M, N, T>& A)
+    template <unsigned int M, unsigned int N, typename T, typename EX, typename EA>
+    constexpr vec<N, T> operator* (const vec_expr<M, T, EX>& x, const mat_expr<M, N, T, EA>& A)
     {
-      vec<N, T>   y;
-      vec<M, T>   col;
-
-      for (unsigned int i = 0; i < N; ++i)
-      {
-        A.get_ith_column(i, col);
-        y(i) = dot(x, col);
-      }
-
-      return  y;
+      return  detail::vec_mat_mul(detail::eval(x.self()), detail::eval(A.self()));
     }
 
     /// C_{mxl} = A_{mxn} * B_{nxl}
-    template <unsigned int M, unsigned int N, unsigned int L, typename T>
-    mat<M, L, T> operator* (const mat<M, N, T>& A, const mat<N, L, T>& B)
+    template <unsigned int M, unsigned int N, unsigned int L, typename T, typename EA, typename EB>
+    constexpr mat<M, L, T> operator* (const mat_expr<M, N, T, EA>& A, const mat_expr<N, L, T, EB>& B)
     {
-      mat<M, L, T>   C;
-      vec<N, T>   row;
-      vec<N, T>   col;
-
-      for (unsigned int i = 0; i < M; ++i)
-      {
-        A.get_ith_row(i, row);
-
-        for (unsigned int j = 0; j < L; ++j)
-        {
-	  B.get_ith_column(j, col);
-          C(i,j) = dot(row, col);
-        }
-      }
-
-      return  C;
+      return  detail::mat_mul(detail::eval(A.self()), detail::eval(B.self()));
     }
 
     /// ostream for vec class
-    template <unsigned int N, typename T>
-    std::ostream& operator << (std::ostream& os, const vec<N, T>& v)
+    template <unsigned int N, typename T, typename E>
+    std::ostream& operator << (std::ostream& os, const vec_expr<N, T, E>& expr)
     {
+      const E& v = expr.self();
+
       os << "[";
       for (unsigned int i = 0; i < N - 1; ++i)
         os << v(i) << ", ";
@@ -135,14 +399,18 @@ namespace kmuvcl {
     }
 
     /// ostream for mat class
-    template <unsigned int M, unsigned int N, typename T>
-    std::ostream& operator << (std::ostream& os, const mat<M, N, T>& A)
+    template <unsigned int M, unsigned int N, typename T, typename E>
+    std::ostream& operator << (std::ostream& os, const mat_expr<M, N, T, E>& expr)
     {
-      vec<N, T>  row;
+      const E& A = expr.self();
+
       for (unsigned int i = 0; i < M; ++i)
       {
-        A.get_ith_row(i, row);
-        os << row << std::endl;
+        os << "[";
+        for (unsigned int j = 0; j < N - 1; ++j)
+          os << A(i, j) << ", ";
+        os << A(i, N - 1);
+        os << "]" << std::endl;
       }
 
       return  os;
@@ -0,0 +1,216 @@
+#ifndef KMUVCL_GRAPHICS_QUAT_HPP
+#define KMUVCL_GRAPHICS_QUAT_HPP
+
+#include <iostream>
+#include <cmath>
+#include "vec.hpp"
+#include "mat.hpp"
+#include "operator.hpp"
+
+namespace kmuvcl {
+  namespace math {
+
+    /// quaternion q = w + xi + yj + zk, stored as (x, y, z, w)
+    ///
+    /// Unit quaternions represent rotations; angles are in degrees like the
+    /// builders in transform.hpp.
+    template <typename T>
+    class quat
+    {
+    public:
+      /// identity rotation
+      quat() : val{ 0, 0, 0, 1 }
+      {}
+
+      quat(const T w, const T x, const T y, const T z) : val{ x, y, z, w }
+      {}
+
+      quat(const T w, const vec<3, T>& v) : val{ v(0), v(1), v(2), w }
+      {}
+
+      T w() const { return  val[3]; }
+      T x() const { return  val[0]; }
+      T y() const { return  val[1]; }
+      T z() const { return  val[2]; }
+
+      /// vector part (x, y, z)
+      vec<3, T> xyz() const
+      {
+        return  vec<3, T>(val[0], val[1], val[2]);
+      }
+
+      // type casting operators
+      operator const T* () const
+      {
+        return  val;
+      }
+
+      /// q* = w - xi - yj - zk, the inverse of a unit quaternion
+      quat conjugate() const
+      {
+        return  quat(val[3], -val[0], -val[1], -val[2]);
+      }
+
+    protected:
+      alignas(vec_traits<4, T>::alignment) T val[4];   // x, y, z, w
+    };
+
+    typedef quat<float>   quatf;
+    typedef quat<double>  quatd;
+
+    /// rotation of 'angle' degrees about the axis (x, y, z)
+    template <typename T>
+    quat<T> angle_axis(T angle, T x, T y, T z)
+    {
+      const T half = angle * static_cast<T>(3.14159265358979323846 / 360.0);
+      const T s = std::sin(half) / std::sqrt(x*x + y*y + z*z);
+
+      return  quat<T>(std::cos(half), s*x, s*y, s*z);
+    }
+
+    /// s = p * q (4D dot product)
+    template <typename T>
+    T dot(const quat<T>& p, const quat<T>& q)
+    {
+      return  p.w()*q.w() + p.x()*q.x() + p.y()*q.y() + p.z()*q.z();
+    }
+
+    /// q / |q|
+    template <typename T>
+    quat<T> normalize(const quat<T>& q)
+    {
+      const T inv_len = static_cast<T>(1) / std::sqrt(dot(q, q));
+      return  quat<T>(q.w()*inv_len, q.x()*inv_len, q.y()*inv_len, q.z()*inv_len);
+    }
+
+    /// r = p q (Hamilton product): rotating by r applies q first, then p
+    template <typename T>
+    quat<T> operator* (const quat<T>& p, const quat<T>& q)
+    {
+      return  quat<T>(p.w()*q.w() - p.x()*q.x() - p.y()*q.y() - p.z()*q.z(),
+                      p.w()*q.x() + p.x()*q.w() + p.y()*q.z() - p.z()*q.y(),
+                      p.w()*q.y() - p.x()*q.z() + p.y()*q.w() + p.z()*q.x(),
+                      p.w()*q.z() + p.x()*q.y() - p.y()*q.x() + p.z()*q.w());
+    }
+
+    /// v' = q v q* for a unit quaternion q
+    ///
+    /// Uses v' = v + w t + u x t with u = (x, y, z) and t = 2 u x v, which is
+    /// two cross products instead of two quaternion products.
+    template <typename T>
+    vec<3, T> operator* (const quat<T>& q, const vec<3, T>& v)
+    {
+      const vec<3, T> u = q.xyz();
+      const vec<3, T> t = static_cast<T>(2) * cross(u, v);
+
+      return  v + q.w() * t + cross(u, t);
+    }
+
+    /// normalized linear interpolation along the shorter arc; cheaper than
+    /// slerp and accurate for small steps, but not constant speed
+    template <typename T>
+    quat<T> nlerp(const quat<T>& p, const quat<T>& q, T t)
+    {
+      const T s = static_cast<T>(1) - t;
+      const T u = dot(p, q) < 0 ? -t : t;
+
+      return  normalize(quat<T>(s*p.w() + u*q.w(), s*p.x() + u*q.x(),
+                                s*p.y() + u*q.y(), s*p.z() + u*q.z()));
+    }
+
+    /// spherical linear interpolation along the shorter arc
+    template <typename T>
+    quat<T> slerp(const quat<T>& p, const quat<T>& q, T t)
+    {
+      T cos_theta = dot(p, q);
+      T sign = static_cast<T>(1);
+      if (cos_theta < 0)
+      {
+        cos_theta = -cos_theta;
+        sign = static_cast<T>(-1);
+      }
+
+      // nearly parallel: sin(theta) -> 0, fall back to nlerp
+      if (cos_theta > static_cast<T>(0.9995))
+        return  nlerp(p, q, t);
+
+      const T theta     = std::acos(cos_theta);
+      const T inv_sin   = static_cast<T>(1) / std::sin(theta);
+      const T s         = std::sin((static_cast<T>(1) - t) * theta) * inv_sin;
+      const T u         = sign * std::sin(t * theta) * inv_sin;
+
+      return  quat<T>(s*p.w() + u*q.w(), s*p.x() + u*q.x(),
+                      s*p.y() + u*q.y(), s*p.z() + u*q.z());
+    }
+
+    /// rotation matrix of a unit quaternion
+    template <typename T>
+    mat<4, 4, T> to_mat4(const quat<T>& q)
+    {
+      const T x = q.x(), y = q.y(), z = q.z(), w = q.w();
+      const T xx = x*x, yy = y*y, zz = z*z;
+      const T xy = x*y, xz = x*z, yz = y*z;
+      const T wx = w*x, wy = w*y, wz = w*z;
+      const T one = static_cast<T>(1), two = static_cast<T>(2);
+
+      mat<4, 4, T> R;
+      R(0, 0) = one - two*(yy + zz);
+      R(0, 1) = two*(xy - wz);
+      R(0, 2) = two*(xz + wy);
+      R(1, 0) = two*(xy + wz);
+      R(1, 1) = one - two*(xx + zz);
+      R(1, 2) = two*(yz - wx);
+      R(2, 0) = two*(xz - wy);
+      R(2, 1) = two*(yz + wx);
+      R(2, 2) = one - two*(xx + yy);
+      R(3, 3) = one;
+
+      return  R;
+    }
+
+    /// unit quaternion of the orthonormal basis whose columns are (x, y, z)
+    template <typename T>
+    quat<T> from_basis(const vec<3, T>& x, const vec<3, T>& y, const vec<3, T>& z)
+    {
+      const T one = static_cast<T>(1), half = static_cast<T>(0.5);
+      const T trace = x(0) + y(1) + z(2);
+
+      // pick the largest of w, x, y, z as the pivot for numerical stability
+      if (trace > 0)
+      {
+        const T s = half / std::sqrt(trace + one);
+        return  quat<T>(static_cast<T>(0.25) / s,
+                        (y(2) - z(1)) * s, (z(0) - x(2)) * s, (x(1) - y(0)) * s);
+      }
+      else if (x(0) > y(1) && x(0) > z(2))
+      {
+        const T s = static_cast<T>(2) * std::sqrt(one + x(0) - y(1) - z(2));
+        return  quat<T>((y(2) - z(1)) / s,
+                        static_cast<T>(0.25) * s, (y(0) + x(1)) / s, (z(0) + x(2)) / s);
+      }
+      else if (y(1) > z(2))
+      {
+        const T s = static_cast<T>(2) * std::sqrt(one + y(1) - x(0) - z(2));
+        return  quat<T>((z(0) - x(2)) / s,
+                        (y(0) + x(1)) / s, static_cast<T>(0.25) * s, (z(1) + y(2)) / s);
+      }
+      else
+      {
+        const T s = static_cast<T>(2) * std::sqrt(one + z(2) - x(0) - y(1));
+        return  quat<T>((x(1) - y(0)) / s,
+                        (z(0) + x(2)) / s, (z(1) + y(2)) / s, static_cast<T>(0.25) * s);
+      }
+    }
+
+    /// ostream for quat class
+    template <typename T>
+    std::ostream& operator << (std::ostream& os, const quat<T>& q)
+    {
+      os << "[" << q.w() << "; " << q.x() << ", " << q.y() << ", " << q.z() << "]";
+      return  os;
+    }
+
+  } // math
+} // kmuvcl
+
+#endif // KMUVCL_GRAPHICS_QUAT_HPP
@@ -0,0 +1,322 @@
+#ifndef KMUVCL_GRAPHICS_SIMD_HPP
+#define KMUVCL_GRAPHICS_SIMD_HPP
+
+// SIMD configuration for kmuvcl::math.
+//
+// KMUVCL_USE_SSE is defined when the target supports SSE2 (every x86-64 build,
+// or 32-bit builds with /arch:SSE2 or -msse2). KMUVCL_USE_AVX is additionally
+// defined when the compiler targets AVX (-mavx, /arch:AVX).
+// Define KMUVCL_NO_SIMD before including any math header to force the scalar
+// templates in operator.hpp.
+
+#if !defined(KMUVCL_NO_SIMD)
+#  if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+      (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define KMUVCL_USE_SSE
+#    include <emmintrin.h>
+#  endif
+#  if defined(KMUVCL_USE_SSE) && defined(__AVX__)
+#    define KMUVCL_USE_AVX
+#    include <immintrin.h>
+#  endif
+#endif
+
+// The SIMD overloads in operator.hpp are constexpr only when the compiler can
+// tell constant evaluation apart (__builtin_is_constant_evaluated: GCC 9,
+// Clang 9, VS 2019 16.5 and later); in a constant expression they then use
+// the scalar templates. With older compilers vec4f dot and mat4f products
+// stay runtime-only unless KMUVCL_NO_SIMD is defined; all other types and
+// operators are constexpr regardless.
+#if defined(__has_builtin)
+#  if __has_builtin(__builtin_is_constant_evaluated)
+#    define KMUVCL_HAS_IS_CONSTANT_EVALUATED
+#  endif
+#endif
+#if !defined(KMUVCL_HAS_IS_CONSTANT_EVALUATED) && \
+    ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9) || \
+     (defined(_MSC_VER) && _MSC_VER >= 1925))
+#  define KMUVCL_HAS_IS_CONSTANT_EVALUATED
+#endif
+
+#ifdef KMUVCL_HAS_IS_CONSTANT_EVALUATED
+#  define KMUVCL_SIMD_CONSTEXPR       constexpr
+#  define KMUVCL_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#  define KMUVCL_SIMD_CONSTEXPR
+#  define KMUVCL_CONSTANT_EVALUATED() false
+#endif
+
+#ifdef KMUVCL_USE_SSE
+
+namespace kmuvcl {
+  namespace math {
+    namespace simd {
+
+      // All kernels work on column-major float arrays and use unaligned
+      // loads, so they accept any float pointer. The vec/mat types keep their
+      // storage 16-byte aligned, which keeps those loads off cache-line splits.
+
+      /// s = v_0 + v_1 + v_2 + v_3
+      inline float hsum(__m128 v)
+      {
+        __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 sums = _mm_add_ps(v, shuf);
+        shuf = _mm_movehl_ps(shuf, sums);
+        sums = _mm_add_ss(sums, shuf);
+        return _mm_cvtss_f32(sums);
+      }
+
+      /// s = a_4 * b_4
+      inline float vec4_dot(const float* a, const float* b)
+      {
+        return hsum(_mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+      }
+
+      /// s = u_3 * v_3 for registers holding padded vec3s (the fourth lane is ignored)
+      inline float dot3(__m128 u, __m128 v)
+      {
+        __m128 m = _mm_mul_ps(u, v);
+        __m128 y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+        __m128 z = _mm_movehl_ps(m, m);
+        return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(m, y), z));
+      }
+
+      /// w_3 = u_3 x v_3 for registers holding padded vec3s (the fourth lane of w is zero)
+      inline __m128 cross3(__m128 u, __m128 v)
+      {
+        __m128 u_yzx = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 v_yzx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 w = _mm_sub_ps(_mm_mul_ps(u, v_yzx), _mm_mul_ps(u_yzx, v));
+        w = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 0, 2, 1));
+
+        // the fourth lane is u.w*v.w - u.w*v.w; clear it in case of inf/nan
+        const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        return _mm_and_ps(w, mask);
+      }
+
+      /// y_4 = A_{4x4} * x_4
+      inline void mat4_mul_vec4(const float* A, const float* x, float* y)
+      {
+        __m128 r = _mm_mul_ps(_mm_loadu_ps(A),      _mm_set1_ps(x[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(A + 4),  _mm_set1_ps(x[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(A + 8),  _mm_set1_ps(x[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(A + 12), _mm_set1_ps(x[3])));
+        _mm_storeu_ps(y, r);
+      }
+
+      /// y_4 = x_4 * A_{4x4}
+      inline void vec4_mul_mat4(const float* x, const float* A, float* y)
+      {
+        __m128 c0 = _mm_loadu_ps(A);
+        __m128 c1 = _mm_loadu_ps(A + 4);
+        __m128 c2 = _mm_loadu_ps(A + 8);
+        __m128 c3 = _mm_loadu_ps(A + 12);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);    // c0..c3 now hold the rows of A
+
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(x[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(x[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(x[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(x[3])));
+        _mm_storeu_ps(y, r);
+      }
+
+      /// C_{4x4} = A_{4x4} * B_{4x4}
+      ///
+      /// Each column of C is a linear combination of the columns of A
+      /// weighted by the matching column of B. C may alias A or B.
+      inline void mat4_mul(const float* A, const float* B, float* C)
+      {
+#ifdef KMUVCL_USE_AVX
+        // two columns of C per iteration: both 128-bit halves hold a copy of
+        // the same column of A, while B supplies the weights of two columns
+        const __m256 a0 = _mm256_broadcast_ps((const __m128*)(A));
+        const __m256 a1 = _mm256_broadcast_ps((const __m128*)(A + 4));
+        const __m256 a2 = _mm256_broadcast_ps((const __m128*)(A + 8));
+        const __m256 a3 = _mm256_broadcast_ps((const __m128*)(A + 12));
+
+        const __m256 b01 = _mm256_loadu_ps(B);
+        const __m256 b23 = _mm256_loadu_ps(B + 8);
+
+        __m256 c01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+        c01 = _mm256_add_ps(c01, _mm256_mul_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55)));
+        c01 = _mm256_add_ps(c01, _mm256_mul_ps(a2, _mm256_shuffle_ps(b01, b01, 0xAA)));
+        c01 = _mm256_add_ps(c01, _mm256_mul_ps(a3, _mm256_shuffle_ps(b01, b01, 0xFF)));
+
+        __m256 c23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00));
+        c23 = _mm256_add_ps(c23, _mm256_mul_ps(a1, _mm256_shuffle_ps(b23, b23, 0x55)));
+        c23 = _mm256_add_ps(c23, _mm256_mul_ps(a2, _mm256_shuffle_ps(b23, b23, 0xAA)));
+        c23 = _mm256_add_ps(c23, _mm256_mul_ps(a3, _mm256_shuffle_ps(b23, b23, 0xFF)));
+
+        _mm256_storeu_ps(C,     c01);
+        _mm256_storeu_ps(C + 8, c23);
+#else
+        const __m128 a0 = _mm_loadu_ps(A);
+        const __m128 a1 = _mm_loadu_ps(A + 4);
+        const __m128 a2 = _mm_loadu_ps(A + 8);
+        const __m128 a3 = _mm_loadu_ps(A + 12);
+
+        __m128 c[4];
+        for (int j = 0; j < 4; ++j)
+        {
+          const float* b = B + 4*j;
+          __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[0]));
+          r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[1])));
+          r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[2])));
+          r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[3])));
+          c[j] = r;
+        }
+
+        _mm_storeu_ps(C,      c[0]);
+        _mm_storeu_ps(C + 4,  c[1]);
+        _mm_storeu_ps(C + 8,  c[2]);
+        _mm_storeu_ps(C + 12, c[3]);
+#endif
+      }
+
+
+      /// adjugate of a 4x4 matrix from its 2x2 sub-determinants
+      ///
+      /// The rows r0..r3 are read as a row-major matrix A. Writing a_ij for
+      /// r_i[j], s_k and c_k for the 2x2 determinants of rows (0,1) and (2,3)
+      /// over the column pairs (0,1) (0,2) (0,3) (1,2) (1,3) (2,3), every row
+      /// of adj(A) is a signed sum of three products X_j * P_k with
+      /// X_j = (a_1j, a_0j, a_3j, a_2j) and P_k = (c_k, c_k, s_k, s_k).
+      /// Returns det(A). Because adj(A^T) = adj(A)^T, the same code inverts
+      /// column-major data.
+      inline float mat4_adjugate(__m128 r0, __m128 r1, __m128 r2, __m128 r3, __m128* adj)
+      {
+        // s0..s3 and c0..c3: pairs (0,1) (0,2) (0,3) (1,2)
+        const __m128 sa = _mm_sub_ps(
+          _mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(1, 0, 0, 0)),
+                     _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(2, 3, 2, 1))),
+          _mm_mul_ps(_mm_shuffle_ps(r1, r1, _MM_SHUFFLE(1, 0, 0, 0)),
+                     _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(2, 3, 2, 1))));
+        const __m128 ca = _mm_sub_ps(
+          _mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(1, 0, 0, 0)),
+                     _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(2, 3, 2, 1))),
+          _mm_mul_ps(_mm_shuffle_ps(r3, r3, _MM_SHUFFLE(1, 0, 0, 0)),
+                     _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(2, 3, 2, 1))));
+
+        // (s4, s5, c4, c5): pairs (1,3) (2,3)
+        const __m128 sc = _mm_sub_ps(
+          _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 1, 2, 1)),
+                     _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 3, 3, 3))),
+          _mm_mul_ps(_mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 1, 2, 1)),
+                     _mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 3, 3, 3))));
+
+        const __m128 p0 = _mm_shuffle_ps(ca, sa, _MM_SHUFFLE(0, 0, 0, 0));
+        const __m128 p1 = _mm_shuffle_ps(ca, sa, _MM_SHUFFLE(1, 1, 1, 1));
+        const __m128 p2 = _mm_shuffle_ps(ca, sa, _MM_SHUFFLE(2, 2, 2, 2));
+        const __m128 p3 = _mm_shuffle_ps(ca, sa, _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128 p4 = _mm_shuffle_ps(sc, sc, _MM_SHUFFLE(0, 0, 2, 2));
+        const __m128 p5 = _mm_shuffle_ps(sc, sc, _MM_SHUFFLE(1, 1, 3, 3));
+
+        // columns of A, lanes swapped pairwise
+        __m128 x0 = r0, x1 = r1, x2 = r2, x3 = r3;
+        _MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+        x0 = _mm_shuffle_ps(x0, x0, _MM_SHUFFLE(2, 3, 0, 1));
+        x1 = _mm_shuffle_ps(x1, x1, _MM_SHUFFLE(2, 3, 0, 1));
+        x2 = _mm_shuffle_ps(x2, x2, _MM_SHUFFLE(2, 3, 0, 1));
+        x3 = _mm_shuffle_ps(x3, x3, _MM_SHUFFLE(2, 3, 0, 1));
+
+        const __m128 sign_a = _mm_setr_ps( 1.0f, -1.0f,  1.0f, -1.0f);
+        const __m128 sign_b = _mm_setr_ps(-1.0f,  1.0f, -1.0f,  1.0f);
+
+        adj[0] = _mm_mul_ps(sign_a, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x1, p5), _mm_mul_ps(x2, p4)), _mm_mul_ps(x3, p3)));
+        adj[1] = _mm_mul_ps(sign_b, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x0, p5), _mm_mul_ps(x2, p2)), _mm_mul_ps(x3, p1)));
+        adj[2] = _mm_mul_ps(sign_a, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x0, p4), _mm_mul_ps(x1, p2)), _mm_mul_ps(x3, p0)));
+        adj[3] = _mm_mul_ps(sign_b, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x0, p3), _mm_mul_ps(x1, p1)), _mm_mul_ps(x2, p0)));
+
+        // det(A) = r0 * (first column of adj(A))
+        const __m128 t01 = _mm_shuffle_ps(adj[0], adj[1], _MM_SHUFFLE(0, 0, 0, 0));
+        const __m128 t23 = _mm_shuffle_ps(adj[2], adj[3], _MM_SHUFFLE(0, 0, 0, 0));
+        return hsum(_mm_mul_ps(r0, _mm_shuffle_ps(t01, t23, _MM_SHUFFLE(2, 0, 2, 0))));
+      }
+
+      /// det(A_{4x4})
+      inline float mat4_determinant(const float* A)
+      {
+        __m128 adj[4];
+        return mat4_adjugate(_mm_loadu_ps(A),     _mm_loadu_ps(A + 4),
+                             _mm_loadu_ps(A + 8), _mm_loadu_ps(A + 12), adj);
+      }
+
+      /// B_{4x4} = A_{4x4}^{-1}; B may alias A
+      inline void mat4_inverse(const float* A, float* B)
+      {
+        __m128 adj[4];
+        const float det = mat4_adjugate(_mm_loadu_ps(A),     _mm_loadu_ps(A + 4),
+                                        _mm_loadu_ps(A + 8), _mm_loadu_ps(A + 12), adj);
+        const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), _mm_set1_ps(det));
+
+        _mm_storeu_ps(B,      _mm_mul_ps(adj[0], inv_det));
+        _mm_storeu_ps(B + 4,  _mm_mul_ps(adj[1], inv_det));
+        _mm_storeu_ps(B + 8,  _mm_mul_ps(adj[2], inv_det));
+        _mm_storeu_ps(B + 12, _mm_mul_ps(adj[3], inv_det));
+      }
+
+      /// rows of L^{-1} for the upper-left 3x3 block L of a column-major 4x4
+      /// matrix: (c1 x c2, c2 x c0, c0 x c1) / det(L) for the columns c_j of L
+      inline void mat3_inverse_rows(const float* A, __m128* rows)
+      {
+        const __m128 c0 = _mm_loadu_ps(A);
+        const __m128 c1 = _mm_loadu_ps(A + 4);
+        const __m128 c2 = _mm_loadu_ps(A + 8);
+
+        const __m128 r0 = cross3(c1, c2);
+        const __m128 r1 = cross3(c2, c0);
+        const __m128 r2 = cross3(c0, c1);
+
+        const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), _mm_set1_ps(dot3(c0, r0)));
+
+        rows[0] = _mm_mul_ps(r0, inv_det);
+        rows[1] = _mm_mul_ps(r1, inv_det);
+        rows[2] = _mm_mul_ps(r2, inv_det);
+      }
+
+      /// B = [L | t]^{-1} = [L^{-1} | -L^{-1} t] for an affine A = [L | t];
+      /// the bottom row of A is assumed to be (0, 0, 0, 1). B may alias A.
+      inline void mat4_affine_inverse(const float* A, float* B)
+      {
+        __m128 rows[4];
+        mat3_inverse_rows(A, rows);
+
+        // the translation goes into lane 3 of each row: -(L^{-1})_i * t.
+        // Lane 3 is cleared first: it is -0.0 when det(L) < 0, and its sign
+        // bit would otherwise be ORed into the translation.
+        const __m128 t = _mm_loadu_ps(A + 12);
+        const __m128 lane3 = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+        for (int i = 0; i < 3; ++i)
+        {
+          const __m128 ti = _mm_set1_ps(-dot3(rows[i], t));
+          rows[i] = _mm_or_ps(_mm_andnot_ps(lane3, rows[i]), _mm_and_ps(ti, lane3));
+        }
+        rows[3] = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+        _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+        _mm_storeu_ps(B,      rows[0]);
+        _mm_storeu_ps(B + 4,  rows[1]);
+        _mm_storeu_ps(B + 8,  rows[2]);
+        _mm_storeu_ps(B + 12, rows[3]);
+      }
+
+      /// N = (L^{-1})^T for the upper-left 3x3 block L of A, written as three
+      /// padded columns (N has 12 floats: column j at N + 4*j)
+      inline void mat4_inverse_transpose3x3(const float* A, float* N)
+      {
+        // the rows of L^{-1} are the columns of its transpose
+        __m128 rows[3];
+        mat3_inverse_rows(A, rows);
+
+        _mm_storeu_ps(N,     rows[0]);
+        _mm_storeu_ps(N + 4, rows[1]);
+        _mm_storeu_ps(N + 8, rows[2]);
+      }
+
+    } // simd
+  } // math
+} // kmuvcl
+
+#endif // KMUVCL_USE_SSE
+
+#endif // KMUVCL_GRAPHICS_SIMD_HPP
@@ -15,8 +15,13 @@ namespace kmuvcl
         const float M_PI = 3.14159265358979323846f;
 #endif
 
+        // translate, scale, ortho and frustum are constexpr, e.g.
+        //   constexpr mat4f model = translate(0.0f, 1.0f, 0.0f) * scale(2.0f, 2.0f, 2.0f);
+        // rotate, lookAt and perspective need <cmath> and run at runtime.
+        // Define KMUVCL_FAST_TRIG to build the rotations with fast_sincos.
+
         template <typename T>
-        mat<4, 4, T> translate(T dx, T dy, T dz)
+        constexpr mat<4, 4, T> translate(T dx, T dy, T dz)
         {
             mat<4, 4, T> translateMat;
             translateMat(0, 0) = static_cast<T>(1);
@@ -30,33 +35,161 @@ namespace kmuvcl
             return translateMat;
         }
 
+        /// degrees to radians, computed in T (no float/double mixing)
+        template <typename T>
+        constexpr T radians(T degrees)
+        {
+            return degrees * static_cast<T>(3.14159265358979323846 / 180.0);
+        }
+
+        /// s = sin(x), c = cos(x) from one range reduction and two short
+        /// polynomials (Cephes sinf/cosf coefficients).
+        ///
+        /// x is reduced to r in [-pi/4, pi/4] with a three-part pi/2. For
+        /// |x| <= 8192 the absolute error is below 1e-7 for float (about one
+        /// ulp near 1) and below 3e-9 for double, whose accuracy is limited by
+        /// the float-grade polynomials. Larger and non-finite x, where the
+        /// reduction loses precision and the quadrant would overflow int, go
+        /// to std::sin/std::cos.
+        template <typename T>
+        void fast_sincos(T x, T& s, T& c)
+        {
+            if (!(std::abs(x) <= static_cast<T>(8192)))
+            {
+                s = std::sin(x);
+                c = std::cos(x);
+                return;
+            }
+
+            const T two_over_pi = static_cast<T>(0.63661977236758134308);
+            const int q = static_cast<int>(x * two_over_pi + (x < 0 ? static_cast<T>(-0.5) : static_cast<T>(0.5)));
+            const T qf = static_cast<T>(q);
+
+            // r = x - q * pi/2
+            const T r = ((x - qf * static_cast<T>(1.5703125))
+                            - qf * static_cast<T>(4.837512969970703125e-4))
+                            - qf * static_cast<T>(7.54978995489188216e-8);
+            const T r2 = r * r;
+
+            const T sr = r + r * r2 * (static_cast<T>(-1.6666654611e-1)
+                                + r2 * (static_cast<T>(8.3321608736e-3)
+                                + r2 * static_cast<T>(-1.9515295891e-4)));
+            const T cr = static_cast<T>(1) - static_cast<T>(0.5) * r2
+                            + r2 * r2 * (static_cast<T>(4.166664568298827e-2)
+                                + r2 * (static_cast<T>(-1.388731625493765e-3)
+                                + r2 * static_cast<T>(2.443315711809948e-5)));
+
+            switch (q & 3)
+            {
+            case 0:  s =  sr; c =  cr; break;
+            case 1:  s =  cr; c = -sr; break;
+            case 2:  s = -sr; c = -cr; break;
+            default: s = -cr; c =  sr; break;
+            }
+        }
+
+        namespace detail
+        {
+            /// sin and cos of the rotation builders: std::sin/std::cos by
+            /// default, fast_sincos when KMUVCL_FAST_TRIG is defined
+            template <typename T>
+            void sin_cos(T x, T& s, T& c)
+            {
+#ifdef KMUVCL_FAST_TRIG
+                fast_sincos(x, s, c);
+#else
+                s = std::sin(x);
+                c = std::cos(x);
+#endif
+            }
+        }
+
         template <typename T>
         mat<4, 4, T> rotate(T angle, T x, T y, T z)
         {
             mat<4, 4, T> rotateMat;
-            T radianAngle = angle * (M_PI / 180.0f);
-            T len = std::sqrt(x*x + y*y + z*z);
-            
-            x /= len;
-            y /= len;
-            z /= len;
-
-            rotateMat(0, 0) = cos(radianAngle) + x * x * (1 - cos(radianAngle));
-            rotateMat(0, 1) = x * y * (1 - cos(radianAngle)) - z * sin(radianAngle);
-            rotateMat(0, 2) = x * z * (1 - cos(radianAngle)) + y * sin(radianAngle);
-            rotateMat(1, 0) = y * x * (1 - cos(radianAngle)) + z * sin(radianAngle);
-            rotateMat(1, 1) = cos(radianAngle) + y * y * (1 - cos(radianAngle));
-            rotateMat(1, 2) = y * z * (1 - cos(radianAngle)) - x * sin(radianAngle);
-            rotateMat(2, 0) = z * x * (1 - cos(radianAngle)) - y * sin(radianAngle);
-            rotateMat(2, 1) = z * y * (1 - cos(radianAngle)) + x * sin(radianAngle);
-            rotateMat(2, 2) = cos(radianAngle) + z * z * (1 - cos(radianAngle));
+            T s, c;
+            detail::sin_cos(radians(angle), s, c);
+
+            const T invLen = static_cast<T>(1) / std::sqrt(x*x + y*y + z*z);
+            x *= invLen;
+            y *= invLen;
+            z *= invLen;
+
+            const T t = static_cast<T>(1) - c;
+            const T tx = t * x, ty = t * y, tz = t * z;
+            const T sx = s * x, sy = s * y, sz = s * z;
+
+            rotateMat(0, 0) = tx * x + c;
+            rotateMat(0, 1) = tx * y - sz;
+            rotateMat(0, 2) = tx * z + sy;
+            rotateMat(1, 0) = tx * y + sz;
+            rotateMat(1, 1) = ty * y + c;
+            rotateMat(1, 2) = ty * z - sx;
+            rotateMat(2, 0) = tx * z - sy;
+            rotateMat(2, 1) = ty * z + sx;
+            rotateMat(2, 2) = tz * z + c;
+            rotateMat(3, 3) = static_cast<T>(1);
+
+            return rotateMat;
+        }
+
+        /// rotation of 'angle' degrees about the x-axis
+        template <typename T>
+        mat<4, 4, T> rotate_x(T angle)
+        {
+            mat<4, 4, T> rotateMat;
+            T s, c;
+            detail::sin_cos(radians(angle), s, c);
+
+            rotateMat(0, 0) = static_cast<T>(1);
+            rotateMat(1, 1) = c;
+            rotateMat(1, 2) = -s;
+            rotateMat(2, 1) = s;
+            rotateMat(2, 2) = c;
+            rotateMat(3, 3) = static_cast<T>(1);
+
+            return rotateMat;
+        }
+
+        /// rotation of 'angle' degrees about the y-axis
+        template <typename T>
+        mat<4, 4, T> rotate_y(T angle)
+        {
+            mat<4, 4, T> rotateMat;
+            T s, c;
+            detail::sin_cos(radians(angle), s, c);
+
+            rotateMat(0, 0) = c;
+            rotateMat(0, 2) = s;
+            rotateMat(1, 1) = static_cast<T>(1);
+            rotateMat(2, 0) = -s;
+            rotateMat(2, 2) = c;
+            rotateMat(3, 3) = static_cast<T>(1);
+
+            return rotateMat;
+        }
+
+        /// rotation of 'angle' degrees about the z-axis
+        template <typename T>
+        mat<4, 4, T> rotate_z(T angle)
+        {
+            mat<4, 4, T> rotateMat;
+            T s, c;
+            detail::sin_cos(radians(angle), s, c);
+
+            rotateMat(0, 0) = c;
+            rotateMat(0, 1) = -s;
+            rotateMat(1, 0) = s;
+            rotateMat(1, 1) = c;
+            rotateMat(2, 2) = static_cast<T>(1);
             rotateMat(3, 3) = static_cast<T>(1);
 
             return rotateMat;
         }
 
         template<typename T>
-        mat<4, 4, T> scale(T sx, T sy, T sz)
+        constexpr mat<4, 4, T> scale(T sx, T sy, T sz)
         {
             mat<4, 4, T> scaleMat;
             scaleMat(0, 0) = sx;
@@ -70,52 +203,38 @@ namespace kmuvcl
         template<typename T>
         mat<4, 4, T> lookAt(T eyeX, T eyeY, T eyeZ, T centerX, T centerY, T centerZ, T upX, T upY, T upZ)
         {
-            mat<4, 4, T> m, v;
-	    //set T inverse matrix
-            v(0, 0) = static_cast<T>(1);
-            v(0, 3) = -eyeX;
-            v(1, 1) = static_cast<T>(1);
-            v(1, 3) = -eyeY;
-            v(2, 2) = static_cast<T>(1);
-            v(2, 3) = -eyeZ;
-            v(3, 3) = static_cast<T>(1);
-	    
-	    //set camera z-axis
-            T x = centerX - eyeX;
-            T y = centerY - eyeY;
-            T z = centerZ - eyeZ;
-	    vec<3, T> zvec(x, y, z);
-            T zLen = sqrt(x * x + y * y + z * z);
-            x /= zLen;
-            y /= zLen;
-            z /= zLen;
-
-	    //set camera x-axis
-            vec<3, T> upvec(upX, upY, upZ);
-            vec<3, T> xvec = cross(zvec, upvec);
-            T xLen = sqrt(dot(xvec, xvec));
-            m(0, 0) = xvec(0) / xLen;
-            m(0, 1) = xvec(1) / xLen;
-            m(0, 2) = xvec(2) / xLen;
-
-	    //set camera y-axis
-            vec<3, T> yvec = cross(xvec, zvec);
-            T yLen = sqrt(dot(yvec, yvec));
-            m(1, 0) = yvec(0) / yLen;
-            m(1, 1) = yvec(1) / yLen;
-            m(1, 2) = yvec(2) / yLen;
-
-            m(2, 0) = -x;
-            m(2, 1) = -y;
-            m(2, 2) = -z;
-
-            m(3, 3) = static_cast<T>(1); //set R inverse matrix
-
-            return m*v;
+            vec<3, T> eye(eyeX, eyeY, eyeZ);
+
+            //set camera z-axis (pointing away from the center)
+            vec<3, T> zvec = eye - vec<3, T>(centerX, centerY, centerZ);
+            zvec = (static_cast<T>(1) / std::sqrt(dot(zvec, zvec))) * zvec;
+
+            //set camera x-axis
+            vec<3, T> xvec = cross(vec<3, T>(upX, upY, upZ), zvec);
+            xvec = (static_cast<T>(1) / std::sqrt(dot(xvec, xvec))) * xvec;
+
+            //set camera y-axis
+            vec<3, T> yvec = cross(zvec, xvec);
+
+            // the view matrix is the rigid inverse of the camera frame [R | eye]:
+            // the rows of R^T are the camera axes and the translation is -R^T * eye
+            mat<4, 4, T> m;
+            for (unsigned int c = 0; c < 3; ++c)
+            {
+                m(0, c) = xvec(c);
+                m(1, c) = yvec(c);
+                m(2, c) = zvec(c);
+            }
+            m(0, 3) = -dot(xvec, eye);
+            m(1, 3) = -dot(yvec, eye);
+            m(2, 3) = -dot(zvec, eye);
+            m(3, 3) = static_cast<T>(1);
+
+            return m;
         }
 
         template<typename T>
-        mat<4, 4, T> ortho(T left, T right, T bottom, T top, T nearVal, T farVal)
+        constexpr mat<4, 4, T> ortho(T left, T right, T bottom, T top, T nearVal, T farVal)
         {
             mat<4, 4, T> orthoMat;
             orthoMat(0, 0) = 2 / (right - left);
@@ -130,7 +249,7 @@ namespace kmuvcl
         }
 
         template<typename T>
-        mat<4, 4, T> frustum(T left, T right, T bottom, T top, T nearVal, T farVal)
+        constexpr mat<4, 4, T> frustum(T left, T right, T bottom, T top, T nearVal, T farVal)
         {
            mat<4, 4, T> frustumMat;
            frustumMat(0, 0) = 2 * nearVal / (right - left);
@@ -147,7 +266,7 @@ namespace kmuvcl
         template<typename T>
         mat<4, 4, T> perspective(T fovy, T aspect, T zNear, T zFar)
         {
-          fovy = (fovy / 2) * (M_PI / 180.0f);
+          fovy = radians(fovy / 2);
           T top = tan(fovy) * zNear;
           T right = top * aspect;
           return frustum(-right, right, -top, top, zNear, zFar);
@@ -3,101 +3,161 @@
 
 #include <iostream>
 #include <algorithm>
+#include <utility>
 
 namespace kmuvcl {
   namespace math {
 
+    /// storage layout of vec<N, T>: number of stored elements and alignment
     template <unsigned int N, typename T>
-    class vec
+    struct vec_traits
+    {
+      static const unsigned int size      = N;
+      static const unsigned int alignment = alignof(T);
+    };
+
+    /// vec4f fills one SSE register
+    template <>
+    struct vec_traits<4, float>
+    {
+      static const unsigned int size      = 4;
+      static const unsigned int alignment = 16;
+    };
+
+    /// vec3f is padded to four floats so that it can be loaded as a vec4f
+    template <>
+    struct vec_traits<3, float>
+    {
+      static const unsigned int size      = 4;
+      static const unsigned int alignment = 16;
+    };
+
+    /// selects the element-generating constructors of vec and mat
+    struct generate_tag {};
+
+    // vec, mat and the operators in operator.hpp are constexpr (C++14), so
+    // fixed transforms can be built at compile time.
+
+    /// base of every N-vector expression; E is the derived type, which provides
+    /// T operator()(unsigned int i) const
+    ///
+    /// Expressions built by the operators in operator.hpp hold references to
+    /// their vec operands and are evaluated element-wise in a single pass when
+    /// they are assigned to a vec. Do not keep them in 'auto' variables.
+    template <unsigned int N, typename T, typename E>
+    class vec_expr
     {
     public:
-      vec()
+      constexpr const E& self() const
       {
-        set_to_zero();
+        return  static_cast<const E&>(*this);
       }
+    };
 
-      vec(const T elem)
-      {
-        std::fill(val, val + N, elem);
-      }
+    template <unsigned int N, typename T>
+    class vec : public vec_expr<N, T, vec<N, T> >
+    {
+    public:
+      constexpr vec() : val()
+      {}
 
-      vec(const T s, const T t) : vec()
-      {
-        val[0] = s;
-        val[1] = t;
-      }
+      /// val_i = gen(i) for every i, with the element list expanded at compile
+      /// time; nothing is zero-filled beforehand
+      template <typename Gen>
+      constexpr vec(const Gen& gen, generate_tag)
+        : vec(gen, std::make_integer_sequence<unsigned int, N>())
+      {}
 
-      vec(const T s, const T t, const T u) : vec()
+      constexpr vec(const T elem) : val()
       {
-        val[0] = s;
-        val[1] = t;
-        val[2] = u;
+        for (unsigned int i = 0; i < vec_traits<N, T>::size; ++i)
+          val[i] = elem;
       }
 
-      vec(const T s, const T t, const T u, const T v) : vec()
-      {
-        val[0] = s;
-        val[1] = t;
-        val[2] = u;
-        val[3] = v;
-      }
+      // the remaining elements (and vec3f padding) are value-initialized to zero
+      constexpr vec(const T s, const T t) : val{ s, t }
+      {}
+
+      constexpr vec(const T s, const T t, const T u) : val{ s, t, u }
+      {}
+
+      constexpr vec(const T s, const T t, const T u, const T v) : val{ s, t, u, v }
+      {}
       
-      vec(const vec<N, T>& other)
-      {
-        std::copy(other.val, other.val + N, val);
-      }
+      constexpr vec(const vec<N, T>& other) = default;
+
+      /// evaluates a vector expression without intermediate vectors
+      template <typename E>
+      constexpr vec(const vec_expr<N, T, E>& expr)
+        : vec(expr.self(), generate_tag())
+      {}
 
-      vec& operator= (const vec<N, T>& other)
+      constexpr vec& operator= (const vec<N, T>& other) = default;
+
+      template <typename E>
+      constexpr vec& operator= (const vec_expr<N, T, E>& expr)
       {
-        std::copy(other.val, other.val + N, val);
+        const E& e = expr.self();
+        for (unsigned int i = 0; i < N; ++i)
+          val[i] = e(i);
+
         return  *this;
       }
 
-      T& operator()(unsigned int i)
+      constexpr T& operator()(unsigned int i)
       {
         return  val[i];
       }
 
-      const T& operator()(unsigned int i) const
+      constexpr const T& operator()(unsigned int i) const
       {
         return  val[i];
       }
 
       // type casting operators
-      operator const T* () const
+      constexpr operator const T* () const
       {
         return  val;
       }
-      operator T* ()
+      constexpr operator T* ()
       {
         return  val;
       }
 
-      vec& operator+=(const vec<N, T>& other)
+      template <typename E>
+      constexpr vec& operator+=(const vec_expr<N, T, E>& expr)
       {
+        const E& e = expr.self();
         for (unsigned int i = 0; i < N; ++i)
-          val[i] += other.val[i];
+          val[i] += e(i);
         
         return *this;
       }
 
-      vec& operator-=(const vec<N, T>& other)
+      template <typename E>
+      constexpr vec& operator-=(const vec_expr<N, T, E>& expr)
       {
+        const E& e = expr.self();
         for (unsigned int i = 0; i < N; ++i)
-          val[i] -= other.val[i];
+          val[i] -= e(i);
 
         return *this;
       }
 
-      void set_to_zero()
+      constexpr void set_to_zero()
       {
-        std::fill(val, val + N, static_cast<T>(0));
+        for (unsigned int i = 0; i < vec_traits<N, T>::size; ++i)
+          val[i] = static_cast<T>(0);
       }
 
-      
-
     protected:
-      T val[N];
+      alignas(vec_traits<N, T>::alignment) T val[vec_traits<N, T>::size];
+
+    private:
+      template <typename Gen, unsigned int... I>
+      constexpr vec(const Gen& gen, std::integer_sequence<unsigned int, I...>)
+        : val{ gen(I)... }
+      {}
     };
 
     // typedef